@@ -1,6 +1,6 @@
 import csv
+import json
 import os
-import re
 import subprocess
 import pandas as pd
 import numpy as np
@@ -11,20 +11,25 @@ from numpy.polynomial.polynomial import Polynomial
 GENERATE_RUNS = True
 PARSE_RUN_OUTPUTS = True
 GRAPH_OUTPUTS = True
+SWEEP_THREADS = True
 
 if (GENERATE_RUNS):
-    functions = ['gaussianBlur', 'boxBlur', 'motionBlur', 'bucketFill', 'bilinearResize', 'bicubicResize', 'nearestNeighborResize']
+    functions = ['gaussianBlur', 'boxBlur', 'motionBlur', 'bucketFill', 'bilinearResize', 'bicubicResize', 'nearestNeighborResize', 'lanczosResize']
     imageSizes = ['small', 'medium', 'large']
 
+    # Write the synthetic medium and large inputs (deterministic, so every machine benchmarks the same pixels)
+    for imageSize in ['medium', 'large']:
+        subprocess.run(f"make generate inputImageSize={imageSize}", shell=True, check=True)
+
     # Ensure the output directory exists
     outputDir = "./runs"
     if not os.path.exists(outputDir):
         os.makedirs(outputDir)
 
-    # Loop through each combination of function and imageSize
+    # Loop through each combination of function and imageSize (benchmark mode writes warmed up, repeated nanosecond timings as JSON)
     for function in functions:
         for imageSize in imageSizes:
-            cmd = f"make run sigma=3.0 boxSize=9 motionLength=15 bucketFillThreshold=75 bucketFillX=800 bucketFillY=170 resizeWidthBilinear=1500 resizeHeightBilinear=2235 resizeWidthBicubic=1500 resizeHeightBicubic=2235 resizeWidthNearestNeighbor=1500 resizeHeightNearestNeighbor=2235 inputImageSize={imageSize} function={function}"
+            cmd = f"make run sigma=3.0 boxSize=9 motionLength=15 bucketFillThreshold=75 bucketFillX=800 bucketFillY=170 resizeWidthBilinear=1500 resizeHeightBilinear=2235 resizeWidthBicubic=1500 resizeHeightBicubic=2235 resizeWidthNearestNeighbor=1500 resizeHeightNearestNeighbor=2235 inputImageSize={imageSize} function={function} benchmark=10 benchmarkOutput={outputDir}/{imageSize}_{function}.json"
 
             outputFile = f"{outputDir}/{imageSize}_{function}.txt"
 
@@ -45,50 +50,34 @@ if (PARSE_RUN_OUTPUTS):
         "timeTakenFunctionExecutionMultipleThreads", "functionExecutionSpeedupFactor"
     ]
 
-    if os.path.exists(csv_file):
-        os.remove(csv_file)
+    def parse_report(file_path):
+        with open(file_path, 'r') as file:
+            report = json.load(file)
+
+        # Median times in milliseconds by (operation, implementation)
+        medians = {(result["operation"], result["implementation"]): result["medianNs"] / 1e6 for result in report["results"]}
+        function = next(operation for operation, _ in medians if operation != "parse")
+        parsing_single, parsing_multi = medians[("parse", "singleThread")], medians[("parse", "multipleThreads")]
+        execution_single, execution_multi = medians[(function, "singleThread")], medians[(function, "multipleThreads")]
+
+        return [
+            os.path.basename(file_path).split("_")[0],
+            function,
+            report["width"] * report["height"],
+            parsing_single,
+            parsing_multi,
+            parsing_single / parsing_multi,
+            execution_single,
+            execution_multi,
+            execution_single / execution_multi
+        ]
 
     with open(csv_file, 'w', newline='') as file:
         writer = csv.writer(file)
         writer.writerow(headers)
-
-    def parse_text(file_path):
-        with open(file_path, 'r') as file:
-            content = file.read()
-
-            file_size = re.search(r'./image-processor.exe.* (\w+) ', content)
-            function = re.search(r'./image-processor.exe.* (\w+)', content)
-            pixel_count = re.search(r'Time taken for parsing input image using (?:a single|multiple) threads.*\((\d+)px\)', content)
-            parsing_time_single = re.search(r'Time taken for parsing input image using a single thread.*: (\d+)', content)
-            parsing_time_multi = re.search(r'Time taken for parsing input image using multiple threads.*: (\d+)', content)
-            parsing_speedup = re.search(r'Multithreading speedup factor: (\d+\.\d+)x', content, re.MULTILINE)
-            execution_time_single = re.search(r'Time taken for applying .* using a single thread: (\d+)', content)
-            execution_time_multi = re.search(r'Time taken for applying .* using multiple threads: (\d+)', content)
-            execution_speedup = re.findall(r'Multithreading speedup factor: (\d+\.\d+)x', content)
-
-            # Account for multiple instances of speedup factors if present
-            execution_speedup_factor = execution_speedup[1] if len(execution_speedup) > 1 else execution_speedup[0] if execution_speedup else "N/A"
-
-            return [
-                file_size.group(1) if file_size else "N/A",
-                function.group(1) if function else "N/A",
-                pixel_count.group(1) if pixel_count else "N/A",
-                parsing_time_single.group(1) if parsing_time_single else "N/A",
-                parsing_time_multi.group(1) if parsing_time_multi else "N/A",
-                parsing_speedup.group(1) if parsing_speedup else "N/A",
-                execution_time_single.group(1) if execution_time_single else "N/A",
-                execution_time_multi.group(1) if execution_time_multi else "N/A",
-                execution_speedup_factor
-            ]
-
-    for filename in os.listdir(directory):
-        if filename.endswith(".txt"):
-            file_path = os.path.join(directory, filename)
-            data = parse_text(file_path)
-            
-            with open(csv_file, 'a', newline='') as file:
-                writer = csv.writer(file)
-                writer.writerow(data)
+        for filename in sorted(os.listdir(directory)):
+            if filename.endswith(".json"):
+                writer.writerow(parse_report(os.path.join(directory, filename)))
 
     print("Data extraction and CSV update complete.")
 
@@ -176,3 +165,34 @@ if (GRAPH_OUTPUTS):
         plt.grid(True)
         plt.show()
 >>>>>>> dev
+
+if (SWEEP_THREADS):
+    # Strong (same image) and weak (image grown with the threads) scaling from 1 thread up to every hardware thread
+    threads = os.cpu_count()
+    subprocess.run(f"make run inputImageSize=large function=all benchmark=5 sweep={threads} sweepOutput=runs/sweep.json", shell=True, check=True)
+    with open("runs/sweep.json", 'r') as file:
+        points = json.load(file)["points"]
+
+    if not os.path.exists("plots"):
+        os.makedirs("plots")
+    for series in ["strong", "weak"]:
+        fig, (speedup_axis, efficiency_axis) = plt.subplots(1, 2, figsize=(14, 6))
+        for operation in dict.fromkeys(point["operation"] for point in points):
+            series_points = [point for point in points if point["operation"] == operation and point["series"] == series]
+            thread_counts = [point["threads"] for point in series_points]
+            speedup_axis.plot(thread_counts, [point["speedup"] for point in series_points], marker='o', label=operation)
+            efficiency_axis.plot(thread_counts, [point["efficiency"] * 100 for point in series_points], marker='o', label=operation)
+        speedup_axis.plot([1, threads], [1, threads], linestyle='--', color='grey', label='Ideal')
+        speedup_axis.set_title(f'{series.capitalize()} Scaling Speedup vs Thread Count')
+        speedup_axis.set_xlabel('Threads')
+        speedup_axis.set_ylabel('Speedup (x)')
+        efficiency_axis.set_title(f'{series.capitalize()} Scaling Parallel Efficiency vs Thread Count')
+        efficiency_axis.set_xlabel('Threads')
+        efficiency_axis.set_ylabel('Efficiency (%)')
+        for axis in (speedup_axis, efficiency_axis):
+            axis.legend()
+            axis.grid(True)
+        plt.savefig(f'plots/{series}_scaling_plot.png')
+        plt.close()
+
+    print("Scaling sweep plots saved.")
@@ -1,12 +1,19 @@
 import tkinter as tk
 from tkinter import ttk
 from PIL import Image
-from subprocess import Popen, PIPE, STDOUT
+from subprocess import Popen, PIPE, STDOUT, DEVNULL
+import os
+import socket
+import time
+
+SERVER_SOCKET = "out/image-processor.sock"
 
 class ImageProcessorApp:
     def __init__(self, root):
         self.root = root
         self.setup_ui()
+        self.server = self.start_server()
+        self.root.protocol("WM_DELETE_WINDOW", self.on_close)
 
     def setup_ui(self):
         self.root.title("Image Processor")
@@ -28,6 +35,61 @@ class ImageProcessorApp:
         self.setup_image_frames()
         self.create_sliders_and_buttons(controls_frame)
 
+    def start_server(self):
+        # Keep one image-processor running so slider changes skip the process start, the parse and the single thread baseline
+        if not hasattr(socket, "AF_UNIX"):
+            return None
+        if os.path.exists(SERVER_SOCKET):
+            os.remove(SERVER_SOCKET)
+        Popen(f"make serve server={SERVER_SOCKET}", shell=True, stdout=DEVNULL, stderr=DEVNULL)
+        deadline = time.time() + 60  # The first run may still have to build it
+        while time.time() < deadline:
+            try:
+                connection = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+                connection.connect(SERVER_SOCKET)
+                return connection.makefile("rw")
+            except OSError:
+                connection.close()
+                time.sleep(0.1)
+        return None
+
+    def on_close(self):
+        if self.server:
+            try:
+                self.server.write("quit\n")
+                self.server.flush()
+            except OSError:
+                pass
+        self.root.destroy()
+
+    def run_server_command(self, arg):
+        request = f"sigma={self.sigma.get()} boxSize={self.boxSize.get()} motionLength={self.motionLength.get()} bucketFillThreshold={self.bucketFillThreshold.get()} bucketFillX={self.bucketFillX.get()} bucketFillY={self.bucketFillY.get()} resizeWidthBilinear={self.resizeWidthBilinear.get()} resizeHeightBilinear={self.resizeHeightBilinear.get()} resizeWidthBicubic={self.resizeWidthBicubic.get()} resizeHeightBicubic={self.resizeHeightBicubic.get()} resizeWidthNearestNeighbor={self.resizeWidthNearestNeighbor.get()} resizeHeightNearestNeighbor={self.resizeHeightNearestNeighbor.get()} inputImageSize={self.inputImageSize.get()} function={arg}"
+        print(request)
+        response = self.send_server_request(request)
+        if response is None:
+            # The server went away: start a new one and retry once, otherwise run through make like without a server
+            self.server = self.start_server()
+            response = self.send_server_request(request) if self.server else None
+        if response is None:
+            self.server = None
+            self.run_command(arg)
+            return
+        self.console.delete("1.0", tk.END)
+        self.console.insert(tk.END, response + "\n")
+        self.console.see(tk.END)
+        if response.startswith("ok"):
+            self.update_output_image(arg)
+
+    def send_server_request(self, request):
+        # One response line, or None when the connection is broken (readline gives '' once the server hung up)
+        try:
+            self.server.write(request + "\n")
+            self.server.flush()
+            response = self.server.readline()
+        except OSError:
+            return None
+        return response.strip() if response else None
+
     def setup_console(self):
         self.console = tk.Text(self.console_frame, height=20, bg='black', fg='white')
         self.console.pack(fill='both', expand=True)
@@ -52,6 +114,10 @@ class ImageProcessorApp:
             self.console.see(tk.END)
 
     def run_command(self, arg):
+        if self.server:
+            self.run_server_command(arg)
+            return
+
         self.root.update_idletasks()
 
         self.console.delete("1.0", tk.END)
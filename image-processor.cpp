@@ -7,6 +7,7 @@
 #include <functional>
 #include <iostream>
 #include <stack>
+#include <sstream>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -15,14 +16,39 @@
 #include <mutex>
 #include <cstring>
 #include <condition_variable>
-#include <future>
 #include <iomanip>
+#include <memory>
+#include <new>
+#include <utility>
+#include <cstdint>
+#include <tuple>
+#include <future>
+#include <filesystem>
+#include <array>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define IMAGE_PROCESSOR_X86_SIMD 1 // AVX2 row kernels are compiled in and picked at runtime when the CPU supports them
+#endif
 
 #ifdef _WIN32
 #include <windows.h>
 #else
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <climits>
+#endif
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#define IMAGE_PROCESSOR_PERF_COUNTERS 1 // Hardware counters are read with perf_event_open
 #endif
 
 /*************************************************************INPUTS AND OUTPUTS*************************************************************/
@@ -35,12 +61,15 @@ const std::string BucketFillOutputFilename = "out/bucketFill.bmp"; // Output
 const std::string BilinearResizedOutputFilename = "out/bilinearResize.bmp"; // Output
 const std::string BicubicResizedOutputFilename = "out/bicubicResize.bmp"; // Output
 const std::string nearestNeighborResizedOutputFilename = "out/nearestNeighborResize.bmp"; // Output
+const std::string LanczosResizedOutputFilename = "out/lanczosResize.bmp"; // Output
+const std::string PipelineOutputFilename = "out/pipeline.bmp"; // Output
 
 /*************************************************************DEFAULT PARAMS*************************************************************/
 
 double sigma = 3.0; // Gaussian blur sigma value (blur radius, significant performance impact)
 int boxSize = 9; // Box blur value (blur radius, must be odd)
 int motionLength = 15; // Define the length of the motion blur
+double motionAngle = 0.0; // Direction of the motion blur in degrees (0 is horizontal, 90 is vertical)
 int bucketFillThreshold = 75; // Threshold for bucket fill
 int bucketFillX = 800; // X pixel location for starting bucket fill
 int bucketFillY = 170; // Y pixel location for starting bucket fill
@@ -50,113 +79,922 @@ int resizeWidthBicubic = 500; // Desired resize width
 int resizeHeightBicubic = 745; // Desired resize height
 int resizeWidthNearestNeighbor = 500; // Desired resize width
 int resizeHeightNearestNeighbor = 745; // Desired resize height
+int resizeWidthLanczos = 500; // Desired resize width
+int resizeHeightLanczos = 745; // Desired resize height
 std::string inputImageSize = "small"; // Which input image to use (small medium large)
-std::string function = "all"; // Which function to run (all gaussianBlur boxBlur motionBlur bucketFill bilinearResize bicubicResize nearestNeighborResize)
+std::string function = "all"; // Which function to run (all gaussianBlur boxBlur motionBlur bucketFill bilinearResize bicubicResize nearestNeighborResize lanczosResize), or a comma separated pipeline of them
+unsigned int threadCount = 0; // Threads shared by the multithreaded operations (0 uses one per hardware thread)
+int tileSize = 64; // Width and height of the output tiles the multithreaded filters and resizes are scheduled in
+bool separableGaussianBlur = true; // Run the Gaussian blur as a horizontal and a vertical 1D pass instead of a full 2D convolution
+bool separableResize = true; // Run the bilinear and bicubic resizes as a horizontal and a vertical pass over a precomputed resize plan
+bool fixedPoint = false; // Run the multithreaded separable Gaussian blur and the resizes with fixed point weights and integer accumulators
+bool streamImages = false; // Run the operation a band of rows at a time from the input file to the output file so memory use stays flat whatever the image size
+int streamMemory = 256; // Rough memory budget of one streamed band in megabytes
+std::string batchInput; // Directory of BMP files (or a file listing one path per line) to run the function on in batch mode
+int benchmarkRepetitions = 0; // Timed runs per operation and implementation in benchmark mode (0 turns benchmark mode off)
+int benchmarkWarmup = 2; // Untimed runs before the timed ones in benchmark mode (fill the caches and the resize plans)
+std::string benchmarkOutput = "out/benchmark.json"; // Benchmark report (.csv for comma separated values, JSON otherwise)
+bool verifyMode = false; // Check every implementation variant against its reference on seeded synthetic images and exit (non-zero if any disagree)
+bool generateInputs = false; // Write the synthetic inputs listed in the benchmark manifest and exit
+std::string benchmarkManifest = "in/manifest.txt"; // Benchmark manifest (name profile width height seed per line, each written to in/<name>Image.bmp and run with inputImageSize=<name>)
+std::string traceOutput; // Chrome trace event JSON the spans of every thread are written to at exit (empty turns tracing off)
+bool hardwareCounters = false; // Run every benchmark case once more with cycles, instructions, LLC misses, dTLB misses and branch misses counted per operation and per pool thread (Linux)
+unsigned int sweepThreads = 0; // Largest thread count of the scaling sweep (1, 2, 4, ... up to it; 0 turns sweep mode off)
+std::string sweepOutput = "out/sweep.json"; // Scaling sweep report (.csv for comma separated values, JSON otherwise)
+bool productionMode = false; // Run only the fastest implementation of each operation, once, decoding and writing once (no single thread baselines), and run all of them at the same time
+std::string serverSocket; // Unix domain socket path to serve requests on (keeps decoded images and the thread pool resident between requests)
+std::string batchOutput = "out/batch"; // Directory batch mode writes its outputs to (under the input file names)
+bool zeroCopyInput = false; // Use the input pixels in place from the memory mapped file instead of copying them into an aligned image
+bool useSimd = true; // Use the vectorized row kernels when the CPU supports them (0 forces the scalar ones)
+std::vector<std::pair<int, int>> bucketFillSeeds; // Extra bucket fill seeds filled together with (bucketFillX, bucketFillY) from the region index
 
 /*************************************************************CONSTS*************************************************************/
 
 constexpr double PI = 3.14159265358979323846; // PI constant
+constexpr const char* ServerParameters[] = {"sigma", "boxSize", "motionLength", "motionAngle", "bucketFillThreshold", "bucketFillX", "bucketFillY", "resizeWidthBilinear", "resizeHeightBilinear",
+    "resizeWidthBicubic", "resizeHeightBicubic", "resizeWidthNearestNeighbor", "resizeHeightNearestNeighbor", "resizeWidthLanczos", "resizeHeightLanczos", "inputImageSize", "function",
+    "separableGaussian", "fixedPoint", "simd", "tileSize"}; // Parameters a server request may set (the rest configure the process, not an operation)
+constexpr const char* FunctionNames[] = {"gaussianBlur", "boxBlur", "motionBlur", "bucketFill", "bilinearResize", "bicubicResize", "nearestNeighborResize", "lanczosResize"}; // Every operation a function or pipeline can name
+constexpr int MaxColorDistance = 442; // Euclidean distance between any two RGB colors rounded up (sqrt(3) * 255 is about 441.7)
+constexpr int FixedPointBits = 14; // Fraction bits of the fixed point weights (1.0 is 1 << 14, so weights fit in int16_t)
+constexpr int GaussianIntermediateBits = 6; // Fraction bits kept between the fixed point Gaussian passes (255 << 6 still fits in int16_t)
+constexpr int ResizeIntermediateBits = 7; // Fraction bits kept between the two fixed point interpolation steps of the direct bilinear and bicubic resizes (int32 intermediates)
+constexpr int SeparableResizeIntermediateBits = 6; // Fraction bits of the int16 buffer between the fixed point separable resize passes (Catmull-Rom and Lanczos-3 overshoot 255 by up to about 30%, 6 bits hold up to 511, 7 would overflow)
+constexpr std::size_t MaxCachedResizePlans = 8; // Resize plans kept around for repeated resizes between the same dimensions
+constexpr std::size_t MaxCachedGaussianKernels = 8; // Gaussian kernels of each form (1D or 2D) kept around for repeated blurs with the same sigmas
+constexpr std::size_t MaxCachedRegionLabels = 16; // Region label maps kept around for repeated bucket fill queries (4 bytes per pixel each)
+constexpr std::size_t MaxServerImages = 8; // Decoded input images the server keeps resident
+constexpr uint64_t BatchLargeImageBytes = 8 << 20; // Batch images at least this big are run one at a time on all the threads, smaller ones get a thread each
+constexpr int VerifyPsnrBound = 40; // Least PSNR in dB of an approximate variant (a max error of a few levels on most pixels)
+constexpr std::size_t TraceBufferEvents = 1 << 16; // Spans each thread keeps for the trace (the oldest are overwritten once it is full)
+constexpr uint64_t PipelineBandBytes = 1 << 20; // Rough size of the widest intermediate of a fused pipeline band, so each stage reads the last one from cache
 
 /*************************************************************STRUCTS*************************************************************/
 
 // RGB structure with the color order as blue, green, red to allow bottom up parsing present in .bmp standard
 struct RGB {
-    uint8_t blue, green, red; 
+    uint8_t blue, green, red;
+};
+
+// Image stored in a single contiguous, cache line aligned allocation (row y starts stride bytes after row y - 1)
+class Image {
+public:
+    static constexpr std::size_t alignment = 64; // Alignment of the buffer and of every row (one cache line)
+
+    Image() = default;
+
+    // Allocate an image with the given dimensions (pixel values are left uninitialized)
+    Image(int width, int height) : imageWidth(width), imageHeight(height), rowStride(alignedRowSize(width)) {
+        std::size_t bytes = static_cast<std::size_t>(rowStride) * height;
+        auto* buffer = static_cast<uint8_t*>(::operator new[](bytes, std::align_val_t(alignment)));
+        storage = std::shared_ptr<uint8_t>(buffer, [](uint8_t* p) { ::operator delete[](p, std::align_val_t(alignment)); });
+        base = buffer;
+    }
+
+    // Wrap pixel memory owned by someone else (owner keeps it alive, a negative stride walks the buffer backwards)
+    Image(uint8_t* firstRow, int width, int height, std::ptrdiff_t stride, std::shared_ptr<void> owner)
+        : imageWidth(width), imageHeight(height), rowStride(stride), base(firstRow), storage(std::move(owner)) {}
+
+    // Copies are deep so that every Image owns (or solely views) its pixels like the old nested vectors did
+    Image(const Image& other) : Image(other.imageWidth, other.imageHeight) {
+        for (int y = 0; y < imageHeight; ++y) {
+            std::memcpy(row(y), other.row(y), rowBytes());
+        }
+    }
+
+    Image& operator=(const Image& other) {
+        if (this != &other) {
+            *this = Image(other);
+        }
+        return *this;
+    }
+
+    Image(Image&& other) noexcept
+        : imageWidth(std::exchange(other.imageWidth, 0)), imageHeight(std::exchange(other.imageHeight, 0)),
+          rowStride(std::exchange(other.rowStride, 0)), base(std::exchange(other.base, nullptr)), storage(std::move(other.storage)) {}
+
+    Image& operator=(Image&& other) noexcept {
+        imageWidth = std::exchange(other.imageWidth, 0);
+        imageHeight = std::exchange(other.imageHeight, 0);
+        rowStride = std::exchange(other.rowStride, 0);
+        base = std::exchange(other.base, nullptr);
+        storage = std::move(other.storage);
+        return *this;
+    }
+
+    int width() const { return imageWidth; }
+    int height() const { return imageHeight; }
+    std::ptrdiff_t stride() const { return rowStride; } // Distance in bytes between the starts of two consecutive rows
+    std::size_t rowBytes() const { return static_cast<std::size_t>(imageWidth) * sizeof(RGB); } // Pixel bytes in one row (no padding)
+    bool empty() const { return base == nullptr || imageWidth <= 0 || imageHeight <= 0; }
+
+    // Row views (image[y][x] keeps working like it did with nested vectors)
+    RGB* row(int y) { return reinterpret_cast<RGB*>(base + y * rowStride); }
+    const RGB* row(int y) const { return reinterpret_cast<const RGB*>(base + y * rowStride); }
+    RGB* operator[](int y) { return row(y); }
+    const RGB* operator[](int y) const { return row(y); }
+
+    // Pixel views
+    RGB& at(int x, int y) { return row(y)[x]; }
+    const RGB& at(int x, int y) const { return row(y)[x]; }
+
+    // View of rows [first, first + count) sharing these pixels
+    Image rowRange(int first, int count) const { return Image(base + first * rowStride, imageWidth, count, rowStride, storage); }
+
+    // Allocation the pixels live in (shared by views, lets caches tell when an image is gone)
+    const std::shared_ptr<void>& buffer() const { return storage; }
+
+    // Row size rounded up so every row starts on its own cache line
+    static std::ptrdiff_t alignedRowSize(int width) {
+        std::size_t bytes = static_cast<std::size_t>(width) * sizeof(RGB);
+        return static_cast<std::ptrdiff_t>((bytes + alignment - 1) / alignment * alignment);
+    }
+
+private:
+    int imageWidth = 0, imageHeight = 0;
+    std::ptrdiff_t rowStride = 0;
+    uint8_t* base = nullptr; // Start of row 0
+    std::shared_ptr<void> storage; // Keeps the pixel memory alive
+};
+
+// Hardware event counts of a thread or an operation (zero for events perf_event_open could not count)
+struct CounterValues {
+    uint64_t cycles = 0, instructions = 0, llcMisses = 0, dtlbMisses = 0, branchMisses = 0;
+    int64_t busyNs = 0; // Time spent running pool chunks (or the whole operation, waits for the workers left out, for the calling thread)
+
+    CounterValues& operator+=(const CounterValues& other) {
+        cycles += other.cycles;
+        instructions += other.instructions;
+        llcMisses += other.llcMisses;
+        dtlbMisses += other.dtlbMisses;
+        branchMisses += other.branchMisses;
+        busyNs += other.busyNs;
+        return *this;
+    }
+
+    CounterValues operator-(const CounterValues& other) const {
+        return {cycles - other.cycles, instructions - other.instructions, llcMisses - other.llcMisses, dtlbMisses - other.dtlbMisses, branchMisses - other.branchMisses, busyNs - other.busyNs};
+    }
+};
+
+// Hardware counters of one thread, opened on its first use and left running so reading them is all a measurement costs
+class PerfCounters {
+public:
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    // Counters of the calling thread
+    static PerfCounters& forThisThread();
+    // Events counted so far (busyNs left at zero)
+    CounterValues read() const;
+    // Whether any event could be counted (perf_event_open is Linux only and needs kernel.perf_event_paranoid <= 2)
+    bool available() const;
+
+private:
+    PerfCounters();
+
+    int files[5] = {-1, -1, -1, -1, -1}; // Cycles, instructions, LLC misses, dTLB misses, branch misses
+};
+
+// One span of a thread's trace
+struct TraceEvent {
+    const char* name; // String literal
+    int64_t startNs, endNs; // Since tracing started
+};
+
+// Ring of the spans one thread recorded, written only by that thread so recording takes no lock
+struct TraceBuffer {
+    std::string threadName;
+    std::vector<TraceEvent> events = std::vector<TraceEvent>(TraceBufferEvents);
+    std::atomic<uint64_t> recorded{0}; // Spans ever recorded (the ring holds the last TraceBufferEvents of them)
+};
+
+// Process-wide timeline of spans, one ring buffer per thread, written out as Chrome trace event JSON (chrome://tracing or Perfetto)
+class Tracer {
+public:
+    // Process-wide tracer (off until started)
+    static Tracer& instance();
+    // Start recording with times relative to now (the calling thread is named main)
+    void start();
+    // Whether spans are being recorded
+    bool enabled() const { return on.load(std::memory_order_relaxed); }
+    // Nanoseconds since tracing started
+    int64_t now() const { return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count(); }
+    // Add a span to the calling thread's ring
+    void record(const char* name, int64_t startNs, int64_t endNs);
+    // Write every thread's spans as Chrome trace event JSON (false if the file could not be written)
+    bool write(const std::string& filename);
+
+private:
+    // Ring of the calling thread, set up on its first span
+    TraceBuffer& threadBuffer();
+
+    std::atomic<bool> on{false};
+    std::chrono::steady_clock::time_point origin;
+    std::thread::id mainThread;
+    std::mutex mutex; // Guards buffers, taken once per thread and when writing
+    std::vector<std::shared_ptr<TraceBuffer>> buffers; // Outlive their threads so pool threads stopped by a resize still show up
+};
+
+// Span recorded from construction to destruction on the calling thread (a single branch when tracing is off)
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name) : name(name), startNs(Tracer::instance().enabled() ? Tracer::instance().now() : -1) {}
+    ~TraceSpan() {
+        if (startNs >= 0) Tracer::instance().record(name, startNs, Tracer::instance().now());
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* name;
+    int64_t startNs;
+};
+
+// Run of tile indices owned by one thread: the owner pops from the front, idle threads steal from the back
+struct alignas(64) TileQueue {
+    std::atomic<uint64_t> range{0}; // First tile in the high 32 bits, one past the last tile in the low 32 bits
+
+    void assign(uint32_t begin, uint32_t end) { range = (static_cast<uint64_t>(begin) << 32) | end; }
+
+    // Take the next tile from the front (-1 once the run is empty)
+    int popFront() {
+        uint64_t current = range.load();
+        while (true) {
+            uint32_t begin = current >> 32, end = static_cast<uint32_t>(current);
+            if (begin >= end) return -1;
+            if (range.compare_exchange_weak(current, (static_cast<uint64_t>(begin + 1) << 32) | end)) return static_cast<int>(begin);
+        }
+    }
+
+    // Steal the last tile from the back (-1 once the run is empty)
+    int popBack() {
+        uint64_t current = range.load();
+        while (true) {
+            uint32_t begin = current >> 32, end = static_cast<uint32_t>(current);
+            if (begin >= end) return -1;
+            if (range.compare_exchange_weak(current, (static_cast<uint64_t>(begin) << 32) | (end - 1))) return static_cast<int>(end - 1);
+        }
+    }
+};
+
+// Persistent pool of worker threads that every multithreaded operation submits its work to
+class ThreadPool {
+public:
+    // Start a pool where the given number of threads (the calling thread included) share each parallelFor
+    explicit ThreadPool(unsigned int threads) { start(threads); }
+    ~ThreadPool() { stop(); }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Number of threads taking part in a parallelFor (the workers plus the calling thread)
+    unsigned int size() const { return static_cast<unsigned int>(workers.size()) + 1; }
+
+    // Count the hardware events and busy time of every chunk per thread (one branch per chunk while off)
+    void countChunks(bool enabled) { counting = enabled; }
+
+    // Counts per thread since the last call (the submitting thread first) and how long the submitting thread waited for the workers, then start again from zero
+    std::vector<CounterValues> takeChunkCounters(int64_t& submitterWaitNs) {
+        std::vector<CounterValues> counters(size());
+        counters.swap(chunkCounters);
+        submitterWaitNs = std::exchange(waitNs, 0);
+        return counters;
+    }
+
+    // Restart the pool with a different number of threads
+    void resize(unsigned int threads) {
+        std::lock_guard<std::mutex> submitLock(submitMutex);
+        stop();
+        start(threads);
+    }
+
+    // Split [0, count) into one contiguous, evenly sized chunk per thread and run body(begin, end) on each, returning once all are done
+    void parallelFor(int count, const std::function<void(int, int)>& body) {
+        if (count <= 0) return;
+        unsigned int chunks = std::min(size(), static_cast<unsigned int>(count));
+        if (chunks == 1) {
+            body(0, count); // Without holding the pool, so parallelFor calls inside a lone chunk still get every thread
+            return;
+        }
+
+        // Nested submissions (checked before touching submitMutex, which the submitting thread may already hold) and concurrent ones run inline instead of waiting for busy workers
+        if (insideJob) {
+            body(0, count);
+            return;
+        }
+        std::unique_lock<std::mutex> submitLock(submitMutex, std::try_to_lock);
+        if (!submitLock.owns_lock()) {
+            body(0, count);
+            return;
+        }
+
+        Job current;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            current = Job{&body, count, chunks, static_cast<uint32_t>(++generation)};
+            job = current;
+            pendingChunks = chunks;
+            claim = static_cast<uint64_t>(current.generation) << 32; // Chunk 0 of the new generation, so claims against the previous job fail
+        }
+        wake.notify_all();
+
+        insideJob = true;
+        runChunks(0, current); // The calling thread works too
+        auto waitStart = counting ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            done.wait(lock, [&] { return pendingChunks == 0; });
+        }
+        insideJob = false;
+        if (counting) {
+            waitNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - waitStart).count();
+        }
+    }
+
+    // Cut a width x height area into tiles and run body(startX, startY, endX, endY) on each, returning once all are done
+    // Every thread starts on its own contiguous run of tiles (neighbouring tiles share input rows) and steals from the back of the other runs when its own is empty
+    void parallelForTiles(int width, int height, int tileWidth, int tileHeight, const std::function<void(int, int, int, int)>& body) {
+        if (width <= 0 || height <= 0) return;
+        tileWidth = std::clamp(tileWidth, 1, width);
+        tileHeight = std::clamp(tileHeight, 1, height);
+        int tilesX = (width + tileWidth - 1) / tileWidth, tilesY = (height + tileHeight - 1) / tileHeight;
+        long long tileCount = static_cast<long long>(tilesX) * tilesY;
+        unsigned int participants = static_cast<unsigned int>(std::min<long long>(size(), tileCount));
+
+        std::vector<TileQueue> queues(participants);
+        for (unsigned int i = 0; i < participants; ++i) {
+            queues[i].assign(static_cast<uint32_t>(tileCount * i / participants), static_cast<uint32_t>(tileCount * (i + 1) / participants));
+        }
+
+        auto runTile = [&](int tile) {
+            TraceSpan span("tile");
+            int startX = (tile % tilesX) * tileWidth, startY = (tile / tilesX) * tileHeight;
+            body(startX, startY, std::min(startX + tileWidth, width), std::min(startY + tileHeight, height));
+        };
+
+        // One chunk per participant, so each thread drains its own queue first and then turns thief
+        parallelFor(static_cast<int>(participants), [&](int begin, int end) {
+            for (int self = begin; self < end; ++self) {
+                for (int tile = queues[self].popFront(); tile >= 0; tile = queues[self].popFront()) {
+                    runTile(tile);
+                }
+                for (unsigned int offset = 1; offset < participants; ++offset) {
+                    TileQueue& victim = queues[(self + offset) % participants];
+                    for (int tile = victim.popBack(); tile >= 0; tile = victim.popBack()) {
+                        runTile(tile);
+                    }
+                }
+            }
+        });
+    }
+
+    // Process-wide pool (created on first use with threadCount threads, 0 meaning one per hardware thread)
+    static ThreadPool& instance();
+
+private:
+    void start(unsigned int threads) {
+        stopping = false;
+        chunkCounters.assign(std::max(threads, 1u), CounterValues());
+        for (unsigned int i = 1; i < std::max(threads, 1u); ++i) {
+            workers.emplace_back(&ThreadPool::workerLoop, this, i);
+        }
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        workers.clear();
+    }
+
+    // A parallelFor as the workers see it, copied out under the mutex so a later job can reuse the fields
+    struct Job {
+        const std::function<void(int, int)>* body = nullptr;
+        int count = 0;
+        unsigned int chunks = 0;
+        uint32_t generation = 0;
+    };
+
+    // Claim the next chunk of the job (false once it has none left or a newer job replaced it)
+    bool claimChunk(const Job& current, unsigned int& chunk) {
+        uint64_t expected = claim.load();
+        while (true) {
+            if (static_cast<uint32_t>(expected >> 32) != current.generation) return false;
+            chunk = static_cast<uint32_t>(expected);
+            if (chunk >= current.chunks) return false;
+            if (claim.compare_exchange_weak(expected, expected + 1)) return true;
+        }
+    }
+
+    // Claim and run chunks of the job until none are left (slot is the thread's place in chunkCounters)
+    void runChunks(unsigned int slot, const Job& current) {
+        for (unsigned int chunk; claimChunk(current, chunk);) {
+            int begin = static_cast<int>(static_cast<long long>(current.count) * chunk / current.chunks);
+            int end = static_cast<int>(static_cast<long long>(current.count) * (chunk + 1) / current.chunks);
+            TraceSpan span("chunk");
+            if (counting) {
+                PerfCounters& counters = PerfCounters::forThisThread();
+                CounterValues before = counters.read();
+                auto start = std::chrono::steady_clock::now();
+                (*current.body)(begin, end);
+                CounterValues slice = counters.read() - before;
+                slice.busyNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+                chunkCounters[slot] += slice;
+            } else {
+                (*current.body)(begin, end);
+            }
+            if (--pendingChunks == 0) {
+                std::lock_guard<std::mutex> lock(mutex);
+                done.notify_all();
+            }
+        }
+    }
+
+    void workerLoop(unsigned int slot) {
+        insideJob = true;
+        uint64_t seenGeneration = 0;
+        while (true) {
+            Job current;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || generation != seenGeneration; });
+                if (stopping) return;
+                seenGeneration = generation;
+                current = job;
+            }
+            runChunks(slot, current);
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::mutex mutex, submitMutex; // mutex guards the job fields, submitMutex lets one parallelFor run at a time
+    std::condition_variable wake, done;
+    bool stopping = false;
+    uint64_t generation = 0; // Bumped for every job so sleeping workers notice it
+    Job job; // Guarded by mutex
+    std::atomic<uint64_t> claim{0}; // Generation of the current job in the high half, its next unclaimed chunk in the low half
+    std::atomic<unsigned int> pendingChunks{0};
+    std::atomic<bool> counting{false};
+    std::vector<CounterValues> chunkCounters; // Written by each thread to its own slot only while counting
+    int64_t waitNs = 0; // Written by the submitting thread only while counting
+    static thread_local bool insideJob; // Set on pool threads and on the submitting thread while its job runs, so nested parallelFor calls run inline
+};
+
+// Row kernels the filters are built from, picked once for the CPU the program runs on (every kernel gives the same result as the scalar one)
+struct RowKernels {
+    const char* name;
+    void (*widen)(float* destination, const uint8_t* source, int count); // destination[i] = source[i]
+    void (*narrow)(uint8_t* destination, const float* source, int count); // destination[i] = clamp(int(source[i]), 0, 255)
+    void (*multiplyAdd)(float* destination, const float* source, float weight, int count); // destination[i] += source[i] * weight
+    void (*add)(uint32_t* destination, const uint32_t* source, int count); // destination[i] += source[i]
+    void (*subtract)(uint32_t* destination, const uint32_t* source, int count); // destination[i] -= source[i]
+    void (*widenInt16)(int16_t* destination, const uint8_t* source, int count); // destination[i] = source[i]
+    void (*multiplyAddInt16)(int32_t* destination, const int16_t* source, int16_t weight, int count); // destination[i] += source[i] * weight
+    void (*roundInt16)(int16_t* destination, const int32_t* source, int shift, int count); // destination[i] = (source[i] + half) >> shift
+    void (*narrowFixed)(uint8_t* destination, const int32_t* source, int shift, int count); // destination[i] = clamp(source[i] >> shift, 0, 255)
+};
+
+// Rasterized motion blur direction:the image is covered by parallel digital lines that each pixel belongs to exactly one of
+struct MotionPath {
+    bool xMajor; // Lines advance one column per step (otherwise one row per step)
+    bool mirrored; // The minor axis is flipped so the offsets never decrease
+    std::vector<int> offsets; // Minor axis offset of a line at every major axis position
+    int firstLine, endLine; // Range [firstLine, endLine) of line origins that touch the image
+};
+
+// Interpolation filters the separable resize supports
+enum class ResizeFilter { Bilinear, Bicubic, Lanczos3 };
+
+// Content of a synthetic input: smooth gradients (resizes and blurs), per pixel noise (worst case for caches and branches) or large flat regions (bucket fill)
+enum class SyntheticProfile { Gradient, Noise, Flat };
+
+// One synthetic input of the benchmark manifest
+struct ManifestEntry {
+    std::string name; // Written to in/<name>Image.bmp
+    SyntheticProfile profile;
+    int width, height;
+    uint64_t seed;
+};
+
+// Source taps and weights of every output position along one axis of a resize
+struct ResizeAxis {
+    int taps = 0; // Taps per output position (positions needing fewer are padded with zero weights)
+    std::vector<int> indices; // Source index of every tap, clamped to the image
+    std::vector<float> weights; // Weight of every tap
+    std::vector<int16_t> fixedWeights; // The same weights in Q14 for the fixed point path
+};
+
+// Everything a resize between two sizes needs besides the pixels, built once and reused for every resize between the same dimensions
+struct ResizePlan {
+    ResizeFilter filter;
+    int sourceWidth, sourceHeight, width, height;
+    ResizeAxis columns, rows;
+};
+
+// Connected regions of the pixels within a threshold of one target color, cached so repeated bucket fills are a label lookup
+struct RegionLabels {
+    std::weak_ptr<void> buffer; // Image allocation the labels were computed from
+    const RGB* firstRow; // Together with the dimensions tells views of the same allocation apart
+    int width, height, threshold;
+    RGB target;
+    std::shared_ptr<const std::vector<int32_t>> labels; // Root pixel index of the region of every pixel (-1 where the color is not within the threshold)
+};
+
+// Header fields of an uncompressed 24 bit BMP needed to find its rows
+struct BmpInfo {
+    int width, height;
+    bool topDown; // Rows are stored top row first (negative height in the header)
+    uint64_t dataOffset; // Offset of the first stored row
+    uint64_t rowSize; // Bytes of a stored row including the padding to 4 bytes
+};
+
+// One operation of a pipeline, able to produce any band of its output rows from just the input rows that band reads
+struct PipelineStage {
+    std::string name, label, outputFilename;
+    int inputWidth = 0, inputHeight = 0; // Size of the stage's input
+    int width = 0, height = 0; // Size of the stage's output
+    bool banded = true; // False when the operation needs its whole input at once (the fused pipeline is split there)
+    std::function<std::pair<int, int>(int, int)> inputRows; // Input rows [first, last) read by the output rows [startRow, endRow)
+    std::function<Image(const Image&, int, int, int)> run; // Output rows [startRow, endRow) from the input rows starting at the given first row
+};
+
+// One timed implementation of an operation in benchmark mode
+struct BenchmarkCase {
+    std::string operation, implementation;
+    std::function<void()> run;
+};
+
+// Timings of a benchmark case in nanoseconds
+struct BenchmarkResult {
+    std::string operation, implementation;
+    int64_t minNs, medianNs, p95Ns;
+    double meanNs, stddevNs;
+    bool counted = false; // Whether the counted run below was made
+    int64_t countedNs = 0; // Duration of the counted run
+    CounterValues counters; // Totals of the counted run over every thread
+    std::vector<CounterValues> threadCounters; // Per pool thread (the calling thread first)
+};
+
+// Timing of one multithreaded implementation at one thread count of a scaling sweep
+struct SweepPoint {
+    std::string series; // "strong" (same image for every thread count) or "weak" (image grown with the thread count)
+    unsigned int threads;
+    int64_t pixels;
+    BenchmarkResult timing;
+    double speedup, efficiency; // Against the same operation on one thread (weak scaling speedups are per pixel)
+};
+
+// Decoded input kept resident by the server (reloaded when the file changes)
+struct ServerImage {
+    Image image;
+    std::filesystem::file_time_type modified;
+    uintmax_t size;
+    uint64_t lastUsed; // Request number of the last use, the least recently used image is dropped first
 };
 
 // Thread management structure used in readBmpMultipleThreads
 struct ThreadData {
     int startRow, endRow;
     const std::string* filename;
-    std::vector<std::vector<RGB>>* image;
+    Image* image;
     int width, rowPadding;
     int headerOffset = 54;
 };
 
+// exp worked out at compile time (std::exp is not constexpr): exp(r) * 2^n with x = n ln 2 + r, |r| <= ln 2 / 2, the Taylor series summed in long double so rounding to double matches std::exp
+constexpr double constexprExp(double x) {
+    constexpr long double Ln2 = 0.693147180559945309417232121458176568L;
+    long double scaled = x / Ln2;
+    long long n = static_cast<long long>(scaled < 0 ? scaled - 0.5L : scaled + 0.5L);
+    long double r = x - n * Ln2, term = 1, result = 1;
+    for (int k = 1; k < 30; ++k) {
+        term *= r / k;
+        result += term;
+    }
+    for (; n > 0; --n) result *= 2;
+    for (; n < 0; ++n) result /= 2;
+    return static_cast<double>(result);
+}
+
+// Gaussian kernels of an integer sigma baked into the binary, worked out in the same order as generateGaussianKernel1D and generateGaussianKernelSingleThread
+template <int Sigma>
+struct BakedGaussianKernel {
+    static constexpr int Size = (6 * Sigma) | 1;
+    std::array<double, Size> weights1D{};
+    std::array<double, Size * Size> weights2D{}; // Row x + Size / 2, column y + Size / 2 like the 2D vector kernel
+
+    constexpr BakedGaussianKernel() {
+        constexpr double sigma = Sigma;
+        constexpr int halfSize = Size / 2;
+        double sum = 0.0;
+        for (int x = -halfSize; x <= halfSize; x++) {
+            weights1D[x + halfSize] = constexprExp(-(x * x) / (2 * sigma * sigma));
+            sum += weights1D[x + halfSize];
+        }
+        for (double& value : weights1D) value /= sum;
+
+        sum = 0.0;
+        for (int x = -halfSize; x <= halfSize; x++) {
+            for (int y = -halfSize; y <= halfSize; y++) {
+                double& value = weights2D[(x + halfSize) * Size + y + halfSize];
+                value = constexprExp(-(x * x + y * y) / (2 * sigma * sigma)) / (2 * PI * sigma * sigma);
+                sum += value;
+            }
+        }
+        for (double& value : weights2D) value /= sum;
+    }
+};
+
+template <int Sigma>
+constexpr BakedGaussianKernel<Sigma> BakedGaussian{};
+
+// Where the baked kernel of one sigma lives
+struct BakedGaussianKernelView {
+    double sigma;
+    int size;
+    const double* weights1D;
+    const double* weights2D;
+};
+
+// Kernels of the whole sigmas the GUI slider reaches, looked up before generating one
+constexpr BakedGaussianKernelView BakedGaussianKernels[] = {
+    {1, BakedGaussian<1>.Size, BakedGaussian<1>.weights1D.data(), BakedGaussian<1>.weights2D.data()},
+    {2, BakedGaussian<2>.Size, BakedGaussian<2>.weights1D.data(), BakedGaussian<2>.weights2D.data()},
+    {3, BakedGaussian<3>.Size, BakedGaussian<3>.weights1D.data(), BakedGaussian<3>.weights2D.data()},
+    {4, BakedGaussian<4>.Size, BakedGaussian<4>.weights1D.data(), BakedGaussian<4>.weights2D.data()},
+    {5, BakedGaussian<5>.Size, BakedGaussian<5>.weights1D.data(), BakedGaussian<5>.weights2D.data()},
+    {6, BakedGaussian<6>.Size, BakedGaussian<6>.weights1D.data(), BakedGaussian<6>.weights2D.data()},
+    {7, BakedGaussian<7>.Size, BakedGaussian<7>.weights1D.data(), BakedGaussian<7>.weights2D.data()},
+    {8, BakedGaussian<8>.Size, BakedGaussian<8>.weights1D.data(), BakedGaussian<8>.weights2D.data()},
+    {9, BakedGaussian<9>.Size, BakedGaussian<9>.weights1D.data(), BakedGaussian<9>.weights2D.data()},
+};
+
 /*************************************************************FUNCTION DECLARATION*************************************************************/
 
 // Create an out folder
 void createOutFolder();
 
+// Parse the optional --name=value flags that follow the positional arguments
+bool parseOptionalFlags(int argc, char* argv[], int firstFlag);
+// Set a parameter (any positional argument or optional flag) from its text value (false for unknown names)
+bool setParameter(const std::string& name, const std::string& value);
+
+// Input file of an inputImageSize: small, medium, large or an entry of the benchmark manifest (false for anything else)
+bool inputFilenameFor(const std::string& size, std::string& filename);
 // Helper function for parsing image
-std::vector<std::vector<RGB>> parseImageHelper();
+Image parseImageHelper();
+// Helper function for timing and implementing an operation or pipeline in streaming mode (false if it cannot be streamed)
+bool streamHelper(const std::vector<std::string>& names);
+// Check that a stage can run on row bands of its input, saying why not when it cannot
+bool streamableStage(const PipelineStage& stage);
+// Helper function for timing and implementing a pipeline of operations with and without fusing them (false if one of them is unknown)
+bool pipelineHelper(const Image& image, const std::vector<std::string>& names);
+// Helper function for timing and implementing a function or pipeline over every image of batchInput (false if nothing could be run)
+bool batchHelper(const std::vector<std::string>& names);
+// Helper function for benchmarking every implementation of the functions (or a pipeline) and writing the report to benchmarkOutput (false if nothing could be run)
+bool benchmarkHelper(const std::vector<std::string>& names);
+// Benchmark cases for the functions (parsing, then the single and multiple thread implementations of each, or a pipeline with and without fusion)
+std::vector<BenchmarkCase> benchmarkCases(const Image& image, const std::vector<std::string>& names);
+// Run a case warmup times untimed and repetitions times timed
+BenchmarkResult runBenchmark(const BenchmarkCase& benchmarkCase, int warmup, int repetitions);
+// Run a case once more with the hardware counters on, for the whole operation and for each pool thread's share of it (false if no counter is available)
+bool countBenchmark(const BenchmarkCase& benchmarkCase, BenchmarkResult& result);
+// Print the counters of a counted benchmark result: IPC, memory traffic per pixel and each thread's busy and idle time
+void printCounters(const BenchmarkResult& result, int64_t pixels);
+// Write benchmark results with the machine and input they were measured on as JSON or CSV (by the file extension)
+bool writeBenchmarkReport(const std::string& filename, const Image& image, const std::vector<BenchmarkResult>& results);
+// Helper function for timing the multithreaded implementations at 1, 2, 4, ... sweepThreads threads and writing the report to sweepOutput (false if nothing could be run)
+bool sweepHelper(const std::vector<std::string>& names);
+// Stack copies of an image on top of each other (a synthetic input with copies times the work)
+Image tileImageRows(const Image& image, int copies);
+// Write scaling sweep results with the machine and input they were measured on as JSON or CSV (by the file extension)
+bool writeSweepReport(const std::string& filename, const Image& image, const std::vector<SweepPoint>& points);
+// Name of the CPU ("unknown" where it cannot be read)
+std::string cpuModel();
+// Quote a string for JSON
+std::string jsonString(const std::string& text);
+// Quote a string for CSV (embedded quotes doubled, nothing else escaped)
+std::string csvField(const std::string& text);
+// Helper function for running jobs (each a function or pipeline) once with their fastest implementation, all at the same time (false if one of them is unknown)
+bool productionHelper(const Image& image, const std::vector<std::vector<std::string>>& jobs);
+// Helper function for serving requests on serverSocket until one asks it to quit (false if the socket could not be set up)
+bool serverHelper();
+// Run one server request line and return its one line response
+std::string handleServerRequest(const std::string& request, std::unordered_map<std::string, ServerImage>& images, uint64_t requestNumber, bool& quit);
+// Encode an image as a BMP file into a POSIX shared memory object (false if it could not be created)
+bool writeBmpToSharedMemory(const std::string& name, const Image& image, uint64_t& bytes);
+// BMP files of a batch: the .bmp files of a directory (sorted) or the paths listed in a file
+std::vector<std::string> listBatchInputs(const std::string& path);
+// Helper function for checking every implementation variant against its reference on seeded synthetic images at many sizes, parameters and thread counts (false if any disagree)
+bool verifyHelper();
+// Largest per channel difference between two images (-1 if their sizes differ), and their PSNR in dB (infinite when equal)
+std::pair<int, double> compareImages(const Image& expected, const Image& actual);
+// Helper function for writing the synthetic input of the benchmark manifest inputImageSize names, or all of them for all (false if there is no such entry or an image could not be written)
+bool generateHelper();
+// Entries of a benchmark manifest (false if it cannot be read or a line is malformed)
+bool readManifest(const std::string& filename, std::vector<ManifestEntry>& entries);
+// Write a seeded synthetic 24 bit BMP a band of rows at a time, so its size is not limited by memory
+bool generateBmp(const std::string& filename, SyntheticProfile profile, int width, int height, uint64_t seed);
+// Fill the rows of an image with rows [firstRow, firstRow + rows.height()) of a synthetic image of the given height (and the rows' width)
+void fillSyntheticRows(Image& rows, SyntheticProfile profile, int height, int firstRow, uint64_t seed);
+// Mix a 64 bit value into well spread bits (splitmix64), so every synthetic pixel depends only on the seed and its position
+uint64_t mixBits(uint64_t value);
+
+// Row kernels for the current CPU (scalar when useSimd is off or no vector extension is available)
+const RowKernels& rowKernels();
+// Scalar row kernels
+void widenRowScalar(float* destination, const uint8_t* source, int count);
+void narrowRowScalar(uint8_t* destination, const float* source, int count);
+void multiplyAddRowScalar(float* destination, const float* source, float weight, int count);
+void addRowScalar(uint32_t* destination, const uint32_t* source, int count);
+void subtractRowScalar(uint32_t* destination, const uint32_t* source, int count);
+void widenInt16RowScalar(int16_t* destination, const uint8_t* source, int count);
+void multiplyAddInt16RowScalar(int32_t* destination, const int16_t* source, int16_t weight, int count);
+void roundInt16RowScalar(int16_t* destination, const int32_t* source, int shift, int count);
+void narrowFixedRowScalar(uint8_t* destination, const int32_t* source, int shift, int count);
+#ifdef IMAGE_PROCESSOR_X86_SIMD
+// AVX2 row kernels (8 floats or 8 uint32 per instruction)
+void widenRowAvx2(float* destination, const uint8_t* source, int count);
+void narrowRowAvx2(uint8_t* destination, const float* source, int count);
+void multiplyAddRowAvx2(float* destination, const float* source, float weight, int count);
+void addRowAvx2(uint32_t* destination, const uint32_t* source, int count);
+void subtractRowAvx2(uint32_t* destination, const uint32_t* source, int count);
+void widenInt16RowAvx2(int16_t* destination, const uint8_t* source, int count);
+void multiplyAddInt16RowAvx2(int32_t* destination, const int16_t* source, int16_t weight, int count);
+void roundInt16RowAvx2(int16_t* destination, const int32_t* source, int shift, int count);
+void narrowFixedRowAvx2(uint8_t* destination, const int32_t* source, int shift, int count);
+#endif
+// Round weights to FixedPointBits fraction bits, nudging the largest so they still sum to exactly one
+void quantizeWeights(const double* weights, int16_t* quantized, int count);
 
 // Helper function for timing and implementing the gaussian blur function
-void gaussianBlurHelper(std::vector<std::vector<RGB>> image);
+void gaussianBlurHelper(const Image& image);
 // Helper function for timing and implementing the box blur function
-void boxBlurHelper(std::vector<std::vector<RGB>> image);
+void boxBlurHelper(const Image& image);
 // Helper function for timing and implementing the motion blur function
-void motionBlurHelper(std::vector<std::vector<RGB>> image);
+void motionBlurHelper(const Image& image);
 // Helper function for timing and implementing the bucket fill function
-void bucketFillHelper(std::vector<std::vector<RGB>> image);
+void bucketFillHelper(const Image& image);
 // Helper function for timing and implementing the bilinear resize function
-void bilinearResizeHelper(std::vector<std::vector<RGB>> image);
+void bilinearResizeHelper(const Image& image);
 // Helper function for timing and implementing the bicubic resize function
-void bicubicResizeHelper(std::vector<std::vector<RGB>> image);
+void bicubicResizeHelper(const Image& image);
 // Helper function for timing and implementing the nearest neighbor resize function
-void nearestNeighborResizeHelper(std::vector<std::vector<RGB>> image);
+void nearestNeighborResizeHelper(const Image& image);
+// Helper function for timing and implementing the Lanczos-3 resize function
+void lanczosResizeHelper(const Image& image);
 
 // Read bitmap images with one thread
-std::vector<std::vector<RGB>> readBmpSingleThread(const std::string& filename);
+Image readBmpSingleThread(const std::string& filename);
 // Generate the Gaussian kernel with one thread
 std::vector<std::vector<double>> generateGaussianKernelSingleThread(double sigma);
 // Apply Gaussian blur to an image with one thread
-std::vector<std::vector<RGB>> applyGaussianBlurSingleThread(const std::vector<std::vector<RGB>>& image, const std::vector<std::vector<double>>& kernel);
+Image applyGaussianBlurSingleThread(const Image& image, const std::vector<std::vector<double>>& kernel);
+// Generate the 1D Gaussian kernel used by the separable blur (the 2D kernel is its outer product with itself)
+std::vector<double> generateGaussianKernel1D(double sigma);
+// Find the baked kernels of a sigma (nullptr when it was not baked)
+const BakedGaussianKernelView* bakedGaussianKernel(double sigma);
+// Least recently used cache of one form of Gaussian kernel by sigma, shared by every thread (make builds a missing kernel)
+template <typename Kernel>
+std::shared_ptr<const Kernel> cachedGaussianKernel(double sigma, const std::function<Kernel()>& make);
+// Look up (or generate and cache) the 1D Gaussian kernel of a sigma
+std::shared_ptr<const std::vector<double>> gaussianKernel1DFor(double sigma);
+// Look up (or generate and cache) the 2D Gaussian kernel of a sigma
+std::shared_ptr<const std::vector<std::vector<double>>> gaussianKernel2DFor(double sigma);
+// Convolve the tile [startX, endX) x [startY, endY) of the image horizontally with the 1D kernel into a float buffer (3 floats per pixel in blue, green, red order)
+void applyGaussianHorizontalPass(const Image& image, const std::vector<double>& kernel, std::vector<float>& horizontal, int startX, int startY, int endX, int endY);
+// Convolve the tile [startX, endX) x [startY, endY) of the horizontal pass result vertically with the 1D kernel into the blurred image
+void applyGaussianVerticalPass(const std::vector<float>& horizontal, const std::vector<double>& kernel, Image& blurredImage, int startX, int startY, int endX, int endY);
+// Apply separable Gaussian blur to an image with one thread
+Image applySeparableGaussianBlurSingleThread(const Image& image, const std::vector<double>& kernel);
+// Compute the sliding horizontal box sums of rows [startY, endY) (3 sums per pixel, each pixel costs one add and one subtract)
+void computeBoxBlurRowSums(const Image& image, int boxSize, std::vector<uint32_t>& rowSums, int startY, int endY);
 // Apply box blur to the image with one thread
-std::vector<std::vector<RGB>> applyBoxBlurSingleThread(const std::vector<std::vector<RGB>>& image, int boxSize);
-// Apply motion blur to the image based on a given motion length with one thread
-std::vector<std::vector<RGB>> applyMotionBlurSingleThread(const std::vector<std::vector<RGB>>& image, int motionLength);
+Image applyBoxBlurSingleThread(const Image& image, int boxSize);
+// Rasterize the motion direction into the line offsets walked by the motion blur
+MotionPath planMotionPath(int width, int height, double angle);
+// Apply motion blur to the image based on a given motion length and angle with one thread
+Image applyMotionBlurSingleThread(const Image& image, int motionLength, double angle);
 // Function to calculate Euclidean distance between two colors in RGB space with one thread
 double colorDistanceSingleThread(const RGB& color1, const RGB& color2);
 // Apply bucket fill to the other image with one thread
-std::vector<std::vector<RGB>> applyBucketFillSingleThread(const std::vector<std::vector<RGB>>& image, int threshold);
+Image applyBucketFillSingleThread(const Image& image, int threshold);
 // Bicubic interpolation kernel based on Catmull-Rom spline with one thread
 double cubicInterpolateSingleThread(double p[4], double x);
 // Function to perform bicubic interpolation on a 4x4 patch of an image with one thread
 double bicubicInterpolateSingleThread(double arr[4][4], double x, double y);
 // Function to resize an image using bicubic interpolation with one thread
-std::vector<std::vector<RGB>> resizeBicubicSingleThread(const std::vector<std::vector<RGB>>& image, int newWidth, int newHeight);
+Image resizeBicubicSingleThread(const Image& image, int newWidth, int newHeight);
 // Function to resize an image using bilinear interpolation with one thread
-std::vector<std::vector<RGB>> resizeBilinearSingleThread(const std::vector<std::vector<RGB>>& image, int newWidth, int newHeight);
+Image resizeBilinearSingleThread(const Image& image, int newWidth, int newHeight);
 // Apply nearest neighbor resizing to the image  with one thread
-std::vector<std::vector<RGB>> nearestNeighborResizeSingleThread(const std::vector<std::vector<RGB>>& image, int newWidth, int newHeight);
+Image nearestNeighborResizeSingleThread(const Image& image, int newWidth, int newHeight);
+// Work out the taps and weights of every output position along one axis
+ResizeAxis planResizeAxis(ResizeFilter filter, int sourceSize, int size);
+// Look up (or build and cache) the plan for resizing between two sizes with a filter
+std::shared_ptr<const ResizePlan> resizePlanFor(ResizeFilter filter, int sourceWidth, int sourceHeight, int width, int height);
+// Resample the tile [startX, endX) x [startY, endY) of the source rows to the output width into a float buffer (3 floats per pixel in blue, green, red order)
+void resizeHorizontalPass(const Image& image, const ResizePlan& plan, std::vector<float>& horizontal, int startX, int startY, int endX, int endY);
+// Resample the tile [startX, endX) x [startY, endY) of the output from the rows of the horizontal pass result
+void resizeVerticalPass(const std::vector<float>& horizontal, const ResizePlan& plan, Image& resized, int startX, int startY, int endX, int endY);
+// Resize an image along a resize plan with one thread
+Image resizeSeparableSingleThread(const Image& image, const ResizePlan& plan);
+// Build the 54 byte header of a 24 bit bottom-up BMP with the given dimensions
+void fillBmpHeader(unsigned char header[54], int width, int height);
+// Check the 54 byte header of a BMP file of the given size and fill in where its rows are
+bool parseBmpHeader(const uint8_t header[54], uint64_t fileSize, BmpInfo& info);
+// Read rows [firstRow, firstRow + rowCount) of an open BMP (row 0 is the bottom row) into an image
+Image readBmpRows(std::ifstream& file, const BmpInfo& info, int firstRow, int rowCount);
+// Append rows [startRow, endRow) of an image to a BMP being streamed out (with their padding)
+void appendBmpRows(std::ofstream& file, const Image& image, int startRow, int endRow);
+// Cut the output rows [startRow, endRow) out of a resize plan, reading only the source rows they need (firstSourceRow is where those start)
+ResizePlan slicePlanRows(const ResizePlan& plan, int startRow, int endRow, int& firstSourceRow);
+// Set up a pipeline stage running the named operation on a width x height input (false for unknown operations and empty resize targets)
+bool planPipelineStage(const std::string& name, int width, int height, PipelineStage& stage);
+// Set up the stages of a pipeline on a width x height input (false if one of the operations is unknown)
+bool planPipeline(const std::vector<std::string>& names, int width, int height, std::vector<PipelineStage>& stages);
+// Input rows of stages[first] read by the output rows [startRow, endRow) of stages[last - 1]
+std::pair<int, int> pipelineInputRows(const std::vector<PipelineStage>& stages, size_t first, size_t last, int startRow, int endRow);
+// Output rows of stages[last - 1] per band so the widest intermediate of a band takes about budget bytes
+int pipelineBandRows(const std::vector<PipelineStage>& stages, size_t first, size_t last, uint64_t budget);
+// Run banded stages[first, last) over the output rows [outputFirstRow, outputFirstRow + output height) one cache sized band per task (source starts at sourceFirstRow)
+void runPipelineBands(const std::vector<PipelineStage>& stages, size_t first, size_t last, const Image& source, int sourceFirstRow, Image& output, int outputFirstRow);
+// Run a pipeline one full size image per stage
+Image runPipelineUnfused(const Image& image, const std::vector<PipelineStage>& stages);
+// Run a pipeline fused into row bands (stages needing their whole input run on their own between the fused runs)
+Image runPipelineFused(const Image& image, const std::vector<PipelineStage>& stages);
 // Save the new image data by copying the original file and replacing the header (for resize) and pixel color data  with one thread
-void writeBmp(const std::string& filename, const std::vector<std::vector<RGB>>& image, bool resize, int resizedWidth=-1, int resizedHeight=-1);
+void writeBmp(const std::string& filename, const Image& image, bool resize, int resizedWidth=-1, int resizedHeight=-1);
 
 // Thread function to read rows. 
 void readRowsMultipleThreads(const ThreadData* data);
 // Function to read BMP images utilizing multiple threads
-std::vector<std::vector<RGB>> readBmpMultipleThreads(const std::string& filename);
-// Generate the Gaussian kernel with multiple threads
-std::vector<std::vector<double>> generateGaussianKernelMultipleThreads(double sigma);
+Image readBmpMultipleThreads(const std::string& filename);
+// Read a 24 bit BMP by memory mapping it, copying the rows into an aligned image on the pool or (zeroCopy) viewing them in place
+Image readBmpMapped(const std::string& filename, bool zeroCopy);
 // Apply Gaussian blur to an image with multiple threads
-std::vector<std::vector<RGB>> applyGaussianBlurMultipleThreads(const std::vector<std::vector<RGB>>& image, const std::vector<std::vector<double>>& kernel);
-// Function to apply box blur to a specific strip of the image
-void applyBoxBlurToStrip(const std::vector<std::vector<RGB>>& image, std::vector<std::vector<RGB>>& blurredImage, int boxSize, int startY, int endY);
+Image applyGaussianBlurMultipleThreads(const Image& image, const std::vector<std::vector<double>>& kernel);
+// Apply separable Gaussian blur to an image with multiple threads (both passes split into tiles)
+Image applySeparableGaussianBlurMultipleThreads(const Image& image, const std::vector<double>& kernel);
+// Fixed point horizontal Gaussian pass over a tile (Q14 weights, results kept with GaussianIntermediateBits fraction bits)
+void applyGaussianHorizontalPassFixed(const Image& image, const std::vector<int16_t>& weights, std::vector<int16_t>& horizontal, int startX, int startY, int endX, int endY);
+// Fixed point vertical Gaussian pass over a tile of the fixed point horizontal pass result
+void applyGaussianVerticalPassFixed(const std::vector<int16_t>& horizontal, const std::vector<int16_t>& weights, Image& blurredImage, int startX, int startY, int endX, int endY);
+// Function to apply box blur to a specific strip of the image from the horizontal row sums
+void applyBoxBlurToStrip(const std::vector<uint32_t>& rowSums, Image& blurredImage, int boxSize, int startY, int endY);
 // Apply box blur to the image using multiple threads
-std::vector<std::vector<RGB>> applyBoxBlurMultipleThreads(const std::vector<std::vector<RGB>>& image, int boxSize);
-// Apply motion blur to the image based on a given motion length with multiple threads
-void applyMotionBlurSegment(const std::vector<std::vector<RGB>>& image, std::vector<std::vector<RGB>>& blurredImage, int startY, int endY, int motionLength);
-// Apply motion blur to the image based on a given motion length with multiple threads
-std::vector<std::vector<RGB>> applyMotionBlurMultipleThreads(const std::vector<std::vector<RGB>>& image, int motionLength);
+Image applyBoxBlurMultipleThreads(const Image& image, int boxSize);
+// Apply motion blur along lines [startLine, endLine) of the path with running sums (one add and one subtract per pixel)
+void applyMotionBlurSegment(const Image& image, Image& blurredImage, const MotionPath& path, int startLine, int endLine, int motionLength);
+// Apply motion blur to the image based on a given motion length and angle with multiple threads
+Image applyMotionBlurMultipleThreads(const Image& image, int motionLength, double angle);
 // Function to calculate Euclidean distance between two colors in RGB space with multiple threads (same as single)
 double colorDistanceMultipleThreads(const RGB& color1, const RGB& color2);
-// Apply bucket fill to the other image with multiple threads
-std::vector<std::vector<RGB>> applyBucketFillMultipleThreads(const std::vector<std::vector<RGB>>& image, int threshold);
+// Check whether a color is within the Euclidean threshold of the target color (compares squared distances, no sqrt)
+bool withinColorThreshold(const RGB& color, const RGB& target, int threshold);
+// Apply bucket fill to the other image with multiple threads (level synchronous span fill over an atomic bitmap)
+Image applyBucketFillMultipleThreads(const Image& image, int threshold);
+// Label the 4-connected regions of pixels within the threshold of the target color with a banded parallel union-find
+std::vector<int32_t> labelColorRegions(const Image& image, const RGB& target, int threshold);
+// Look up (or compute and cache) the region labels of the image for a threshold and target color
+std::shared_ptr<const std::vector<int32_t>> regionLabelsFor(const Image& image, const RGB& target, int threshold);
+// Apply bucket fill from every seed at once using the cached region labels (a label lookup per seed and one masked pass over the image)
+Image applyBucketFillIndexed(const Image& image, int threshold, const std::vector<std::pair<int, int>>& seeds);
 // Bicubic interpolation kernel based on Catmull-Rom spline with multiple threads (same as single)
 double cubicInterpolateMultipleThreads(double p[4], double x);
 // Function to perform bicubic interpolation on a 4x4 patch of an image with multiple threads (same as single)
 double bicubicInterpolateMultipleThreads(double arr[4][4], double x, double y);
 // Function to process a segment of the image for resizing, running in a separate thread
-void processSegmentMultipleThreads(const std::vector<std::vector<RGB>>& image, std::vector<std::vector<RGB>>& resized, int startRow, int endRow, int newWidth, double xRatio, double yRatio);
+void processSegmentMultipleThreads(const Image& image, Image& resized, int startCol, int startRow, int endCol, int endRow, double xRatio, double yRatio);
+// Fixed point version of processSegmentMultipleThreads (Q14 Catmull-Rom weights, integer accumulators)
+void processSegmentFixed(const Image& image, Image& resized, int startCol, int startRow, int endCol, int endRow, double xRatio, double yRatio);
 // Function to resize an image using bicubic interpolation with multiple threads
-std::vector<std::vector<RGB>> resizeBicubicMultipleThreads(const std::vector<std::vector<RGB>>& image, int newWidth, int newHeight);
+Image resizeBicubicMultipleThreads(const Image& image, int newWidth, int newHeight);
 // Thread function to resize a segment of the image
-void resizeSegmentMultipleThreads(const std::vector<std::vector<RGB>>& image, std::vector<std::vector<RGB>>& resized, double xRatio, double yRatio, int startY, int endY, int newWidth);
+void resizeSegmentMultipleThreads(const Image& image, Image& resized, double xRatio, double yRatio, int startX, int startY, int endX, int endY);
+// Fixed point version of resizeSegmentMultipleThreads (Q14 weights, integer accumulators)
+void resizeSegmentFixed(const Image& image, Image& resized, double xRatio, double yRatio, int startX, int startY, int endX, int endY);
 // Function to resize an image using bilinear interpolation with multiple threads
-std::vector<std::vector<RGB>> resizeBilinearMultipleThreads(const std::vector<std::vector<RGB>>& image, int newWidth, int newHeight);
+Image resizeBilinearMultipleThreads(const Image& image, int newWidth, int newHeight);
 // Apply nearest neighbor resizing to the image with multiple threads
-std::vector<std::vector<RGB>> nearestNeighborResizeMultipleThreads(const std::vector<std::vector<RGB>>& image, int newWidth, int newHeight);
+Image nearestNeighborResizeMultipleThreads(const Image& image, int newWidth, int newHeight);
+// Fixed point horizontal resize pass over a tile (results kept in int16 with SeparableResizeIntermediateBits fraction bits)
+void resizeHorizontalPassFixed(const Image& image, const ResizePlan& plan, std::vector<int16_t>& horizontal, int startX, int startY, int endX, int endY);
+// Fixed point vertical resize pass over a tile of the fixed point horizontal pass result
+void resizeVerticalPassFixed(const std::vector<int16_t>& horizontal, const ResizePlan& plan, Image& resized, int startX, int startY, int endX, int endY);
+// Resize an image along a resize plan with multiple threads (both passes split into tiles)
+Image resizeSeparableMultipleThreads(const Image& image, const ResizePlan& plan);
+// Save the image as a BMP with multiple threads (the file is sized up front and every thread encodes and writes its own band of rows)
+void writeBmpMultipleThreads(const std::string& filename, const Image& image, bool resize, int resizedWidth=-1, int resizedHeight=-1);
 
 /*************************************************************FUNCTION DEFINITION*************************************************************/
 
@@ -183,15 +1021,31 @@ int main(int argc, char* argv[]) {
     inputImageSize = argv[13];
     function = argv[14];
 
+    // Parse the optional flags
+    if (!parseOptionalFlags(argc, argv, 15)) {
+        return 1;
+    }
+
+    // Tracing records spans from here on and writes them out when the program exits
+    if (!traceOutput.empty()) {
+        Tracer::instance().start();
+        std::atexit([] {
+            if (Tracer::instance().write(traceOutput)) {
+                std::cout << "Saved trace to \"" << traceOutput << "\"" << std::endl;
+            } else {
+                std::cerr << "Could not write trace to: " << traceOutput << std::endl;
+            }
+        });
+    }
+
+    // Generate mode writes the synthetic inputs and exits
+    if (generateInputs) {
+        return generateHelper() ? 0 : 1;
+    }
+
     // Check what input file to use based on parameter
-    if (inputImageSize == "small") {
-        InputFilename = "in/smallImage.bmp";
-    } else if (inputImageSize == "medium") {
-        InputFilename = "in/mediumImage.bmp";
-    } else if (inputImageSize == "large") {
-        InputFilename = "in/largeImage.bmp";
-    } else {
-        std::cerr << "Unknown input image size: " << InputFilename << std::endl;
+    if (!inputFilenameFor(inputImageSize, InputFilename)) {
+        std::cerr << "Unknown input image size: " << inputImageSize << std::endl;
         return 1;
     }
 
@@ -199,17 +1053,81 @@ int main(int argc, char* argv[]) {
     std::cout << std::endl;
 
     createOutFolder(); // Create an out folder
+
+    // A comma separated function runs the operations one after another as a pipeline
+    std::vector<std::string> pipeline;
+    for (size_t start = 0, comma; start <= function.size(); start = comma + 1) {
+        comma = std::min(function.find(',', start), function.size());
+        pipeline.push_back(function.substr(start, comma - start));
+    }
+
+    // Verify mode checks the implementations against each other on synthetic images
+    if (verifyMode) {
+        return verifyHelper() ? 0 : 1;
+    }
+
+    // Server mode takes its inputs and parameters from the requests
+    if (!serverSocket.empty()) {
+        return serverHelper() ? 0 : 1;
+    }
+
+    // Batch mode runs over its own list of inputs
+    if (!batchInput.empty()) {
+        return batchHelper(pipeline) ? 0 : 1;
+    }
+
+    // Streaming mode never holds the whole image, so it skips the parse and runs straight from the file
+    if (streamImages) {
+        if (function != "all") {
+            return streamHelper(pipeline) ? 0 : 1;
+        }
+        for (const char* name : FunctionNames) {
+            PipelineStage stage;
+            if (!planPipelineStage(name, 1, 1, stage)) return 1;
+            if (!streamableStage(stage)) continue; // Skipped with a note, the rest still stream
+            if (!streamHelper({name})) return 1;
+        }
+        return 0;
+    }
+
+    // Sweep mode decodes and times everything itself, at every thread count
+    if (sweepThreads > 0) {
+        return sweepHelper(pipeline) ? 0 : 1;
+    }
+
+    // Benchmark mode decodes and times everything itself
+    if (benchmarkRepetitions > 0) {
+        return benchmarkHelper(pipeline) ? 0 : 1;
+    }
+
     auto image = parseImageHelper(); // Helper function for parsing image  
 
+    // Production mode runs each operation once (all of them side by side for all) and skips the comparisons
+    if (productionMode) {
+        if (image.empty()) {
+            return 1;
+        }
+        std::vector<std::vector<std::string>> jobs = {pipeline};
+        if (function == "all") {
+            jobs = {{"gaussianBlur"}, {"motionBlur"}, {"lanczosResize"}, {"bicubicResize"}, {"boxBlur"}, {"bucketFill"}, {"bilinearResize"}, {"nearestNeighborResize"}}; // Slowest first so the short ones fill in at the end
+        }
+        return productionHelper(image, jobs) ? 0 : 1;
+    }
+
+    if (pipeline.size() > 1) {
+        return pipelineHelper(image, pipeline) ? 0 : 1;
+    }
+
     // Map of functions to their respective handlers
-    std::unordered_map<std::string, std::function<void(std::vector<std::vector<RGB>>&)> > functions = {
+    std::unordered_map<std::string, std::function<void(const Image&)> > functions = {
         {"gaussianBlur", gaussianBlurHelper},
         {"boxBlur", boxBlurHelper},
         {"motionBlur", motionBlurHelper},
         {"bucketFill", bucketFillHelper},
         {"bilinearResize", bilinearResizeHelper},
         {"bicubicResize", bicubicResizeHelper},
-        {"nearestNeighborResize", nearestNeighborResizeHelper}
+        {"nearestNeighborResize", nearestNeighborResizeHelper},
+        {"lanczosResize", lanczosResizeHelper}
     };
 
     // Execute specified function (if provided) ohterwise execute all
@@ -229,78 +1147,1672 @@ int main(int argc, char* argv[]) {
     return 0;
 }
 
-// Create an out folder
-void createOutFolder() {
-    const char* dir = "out";
+// Set on pool threads and on the submitting thread while its job runs, so nested parallelFor calls run inline
+thread_local bool ThreadPool::insideJob = false;
 
-    // Using the OS (probably a better way to do this....)
-    #ifdef _WIN32
-        if (!CreateDirectory(dir, NULL)) {
-            if (GetLastError() == ERROR_ALREADY_EXISTS) {
-                std::cout << "Directory already exists.\n";
-            } else {
-                std::cout << "Failed to create directory.\n";
-            }
-        } else {
-            std::cout << "Directory created successfully.\n";
-        }
-    #else
-        struct stat st;
-        if (stat(dir, &st) != 0) {
-            if (mkdir(dir, 0755) == 0) {
-                std::cout << "Directory created successfully.\n" << std::endl;
-            } else {
-                perror("Failed to create directory");
-            }
-        } else {
-            std::cout << "Directory already exists.\n" << std::endl;
+// Process-wide pool (created on first use with threadCount threads, 0 meaning one per hardware thread)
+ThreadPool& ThreadPool::instance() {
+    static ThreadPool pool(threadCount != 0 ? threadCount : std::max(std::thread::hardware_concurrency(), 1u));
+    return pool;
+}
+
+PerfCounters::PerfCounters() {
+#ifdef IMAGE_PROCESSOR_PERF_COUNTERS
+    const std::pair<uint32_t, uint64_t> events[5] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+        {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES}
+    };
+    for (int i = 0; i < 5; ++i) {
+        perf_event_attr attributes{};
+        attributes.size = sizeof(attributes);
+        attributes.type = events[i].first;
+        attributes.config = events[i].second;
+        attributes.exclude_kernel = 1; // User space only, which unprivileged processes may count
+        attributes.exclude_hv = 1;
+        files[i] = static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, PERF_FLAG_FD_CLOEXEC)); // This thread, on any CPU
+    }
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef IMAGE_PROCESSOR_PERF_COUNTERS
+    for (int file : files) {
+        if (file >= 0) close(file);
+    }
+#endif
+}
+
+// Counters of the calling thread
+PerfCounters& PerfCounters::forThisThread() {
+    thread_local PerfCounters counters;
+    return counters;
+}
+
+// Events counted so far (busyNs left at zero)
+CounterValues PerfCounters::read() const {
+    uint64_t counts[5] = {};
+#ifdef IMAGE_PROCESSOR_PERF_COUNTERS
+    for (int i = 0; i < 5; ++i) {
+        if (files[i] >= 0 && ::read(files[i], &counts[i], sizeof(counts[i])) != sizeof(counts[i])) counts[i] = 0;
+    }
+#endif
+    return {counts[0], counts[1], counts[2], counts[3], counts[4], 0};
+}
+
+// Whether any event could be counted (perf_event_open is Linux only and needs kernel.perf_event_paranoid <= 2)
+bool PerfCounters::available() const {
+    return std::any_of(std::begin(files), std::end(files), [](int file) { return file >= 0; });
+}
+
+// Process-wide tracer (off until started)
+Tracer& Tracer::instance() {
+    static Tracer tracer;
+    return tracer;
+}
+
+// Start recording with times relative to now (the calling thread is named main)
+void Tracer::start() {
+    origin = std::chrono::steady_clock::now();
+    mainThread = std::this_thread::get_id();
+    on = true;
+}
+
+// Add a span to the calling thread's ring
+void Tracer::record(const char* name, int64_t startNs, int64_t endNs) {
+    TraceBuffer& buffer = threadBuffer();
+    uint64_t recorded = buffer.recorded.load(std::memory_order_relaxed);
+    buffer.events[recorded % TraceBufferEvents] = {name, startNs, endNs};
+    buffer.recorded.store(recorded + 1, std::memory_order_release);
+}
+
+// Ring of the calling thread, set up on its first span
+TraceBuffer& Tracer::threadBuffer() {
+    thread_local std::shared_ptr<TraceBuffer> buffer;
+    if (!buffer) {
+        buffer = std::make_shared<TraceBuffer>();
+        std::lock_guard<std::mutex> lock(mutex);
+        buffer->threadName = std::this_thread::get_id() == mainThread ? std::string("main") : "thread " + std::to_string(buffers.size());
+        buffers.push_back(buffer);
+    }
+    return *buffer;
+}
+
+// Write every thread's spans as Chrome trace event JSON (false if the file could not be written)
+bool Tracer::write(const std::string& filename) {
+    std::ofstream trace(filename);
+    if (!trace) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    trace << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    bool first = true;
+    for (size_t thread = 0; thread < buffers.size(); ++thread) {
+        const TraceBuffer& buffer = *buffers[thread];
+        trace << (first ? "" : ",\n") << "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << thread << ", \"args\": {\"name\": " << jsonString(buffer.threadName) << "}}";
+        first = false;
+
+        // Complete events in microseconds, oldest first (only the last TraceBufferEvents survive a full ring)
+        uint64_t recorded = buffer.recorded.load(std::memory_order_acquire);
+        for (uint64_t i = recorded > TraceBufferEvents ? recorded - TraceBufferEvents : 0; i < recorded; ++i) {
+            const TraceEvent& event = buffer.events[i % TraceBufferEvents];
+            trace << ",\n  {\"name\": " << jsonString(event.name) << ", \"ph\": \"X\", \"pid\": 1, \"tid\": " << thread << ", \"ts\": " << event.startNs / 1e3 << ", \"dur\": " << (event.endNs - event.startNs) / 1e3 << "}";
         }
-    #endif
+    }
+    trace << "\n]}\n";
+    return static_cast<bool>(trace);
+}
+
+// Row kernels for the current CPU (scalar when useSimd is off or no vector extension is available)
+const RowKernels& rowKernels() {
+    static const RowKernels scalar = {"scalar", widenRowScalar, narrowRowScalar, multiplyAddRowScalar, addRowScalar, subtractRowScalar,
+        widenInt16RowScalar, multiplyAddInt16RowScalar, roundInt16RowScalar, narrowFixedRowScalar};
+#ifdef IMAGE_PROCESSOR_X86_SIMD
+    static const RowKernels avx2 = {"avx2", widenRowAvx2, narrowRowAvx2, multiplyAddRowAvx2, addRowAvx2, subtractRowAvx2,
+        widenInt16RowAvx2, multiplyAddInt16RowAvx2, roundInt16RowAvx2, narrowFixedRowAvx2};
+    static const bool hasAvx2 = __builtin_cpu_supports("avx2");
+    if (useSimd && hasAvx2) return avx2;
+#endif
+    return scalar;
+}
+
+void widenRowScalar(float* destination, const uint8_t* source, int count) {
+    for (int i = 0; i < count; ++i) {
+        destination[i] = source[i];
+    }
+}
+
+void narrowRowScalar(uint8_t* destination, const float* source, int count) {
+    for (int i = 0; i < count; ++i) {
+        destination[i] = static_cast<uint8_t>(std::clamp(static_cast<int>(source[i]), 0, 255));
+    }
+}
+
+void multiplyAddRowScalar(float* destination, const float* source, float weight, int count) {
+    for (int i = 0; i < count; ++i) {
+        destination[i] += source[i] * weight;
+    }
 }
 
-// Helper function for parsing image
-std::vector<std::vector<RGB>> parseImageHelper() {
-    std::cout << "Parsing input image using a single thread..." << std::endl;
+void addRowScalar(uint32_t* destination, const uint32_t* source, int count) {
+    for (int i = 0; i < count; ++i) {
+        destination[i] += source[i];
+    }
+}
+
+void subtractRowScalar(uint32_t* destination, const uint32_t* source, int count) {
+    for (int i = 0; i < count; ++i) {
+        destination[i] -= source[i];
+    }
+}
+
+void widenInt16RowScalar(int16_t* destination, const uint8_t* source, int count) {
+    for (int i = 0; i < count; ++i) {
+        destination[i] = source[i];
+    }
+}
+
+void multiplyAddInt16RowScalar(int32_t* destination, const int16_t* source, int16_t weight, int count) {
+    for (int i = 0; i < count; ++i) {
+        destination[i] += source[i] * weight;
+    }
+}
+
+void roundInt16RowScalar(int16_t* destination, const int32_t* source, int shift, int count) {
+    int32_t half = 1 << (shift - 1);
+    for (int i = 0; i < count; ++i) {
+        destination[i] = static_cast<int16_t>((source[i] + half) >> shift);
+    }
+}
+
+void narrowFixedRowScalar(uint8_t* destination, const int32_t* source, int shift, int count) {
+    for (int i = 0; i < count; ++i) {
+        destination[i] = static_cast<uint8_t>(std::clamp(source[i] >> shift, 0, 255));
+    }
+}
+
+#ifdef IMAGE_PROCESSOR_X86_SIMD
+// The AVX2 kernels finish the last count % 8 elements with the scalar kernels, multiply and add stay separate instructions (no FMA) so results match them exactly
+
+__attribute__((target("avx2"))) void widenRowAvx2(float* destination, const uint8_t* source, int count) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(source + i));
+        _mm256_storeu_ps(destination + i, _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes)));
+    }
+    widenRowScalar(destination + i, source + i, count - i);
+}
+
+__attribute__((target("avx2"))) void narrowRowAvx2(uint8_t* destination, const float* source, int count) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i values = _mm256_cvttps_epi32(_mm256_loadu_ps(source + i)); // Truncate like static_cast<int>
+        __m128i words = _mm_packus_epi32(_mm256_castsi256_si128(values), _mm256_extracti128_si256(values, 1)); // Saturate below 0
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(destination + i), _mm_packus_epi16(words, words)); // Saturate above 255
+    }
+    narrowRowScalar(destination + i, source + i, count - i);
+}
+
+__attribute__((target("avx2"))) void multiplyAddRowAvx2(float* destination, const float* source, float weight, int count) {
+    __m256 weights = _mm256_set1_ps(weight);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 product = _mm256_mul_ps(_mm256_loadu_ps(source + i), weights);
+        _mm256_storeu_ps(destination + i, _mm256_add_ps(_mm256_loadu_ps(destination + i), product));
+    }
+    multiplyAddRowScalar(destination + i, source + i, weight, count - i);
+}
+
+__attribute__((target("avx2"))) void addRowAvx2(uint32_t* destination, const uint32_t* source, int count) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i sum = _mm256_add_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(destination + i)), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i), sum);
+    }
+    addRowScalar(destination + i, source + i, count - i);
+}
+
+__attribute__((target("avx2"))) void subtractRowAvx2(uint32_t* destination, const uint32_t* source, int count) {
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i difference = _mm256_sub_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(destination + i)), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i), difference);
+    }
+    subtractRowScalar(destination + i, source + i, count - i);
+}
+
+__attribute__((target("avx2"))) void widenInt16RowAvx2(int16_t* destination, const uint8_t* source, int count) {
+    int i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i), _mm256_cvtepu8_epi16(bytes));
+    }
+    widenInt16RowScalar(destination + i, source + i, count - i);
+}
+
+__attribute__((target("avx2"))) void multiplyAddInt16RowAvx2(int32_t* destination, const int16_t* source, int16_t weight, int count) {
+    // Pair every sample with a zero so one madd gives the 32 bit products of 16 bit lanes
+    __m256i weights = _mm256_set1_epi32(static_cast<uint16_t>(weight));
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i samples = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i)));
+        __m256i products = _mm256_madd_epi16(samples, weights);
+        __m256i* accumulators = reinterpret_cast<__m256i*>(destination + i);
+        _mm256_storeu_si256(accumulators, _mm256_add_epi32(_mm256_loadu_si256(accumulators), products));
+    }
+    multiplyAddInt16RowScalar(destination + i, source + i, weight, count - i);
+}
+
+__attribute__((target("avx2"))) void roundInt16RowAvx2(int16_t* destination, const int32_t* source, int shift, int count) {
+    __m256i half = _mm256_set1_epi32(1 << (shift - 1));
+    __m128i shiftCount = _mm_cvtsi32_si128(shift);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i values = _mm256_sra_epi32(_mm256_add_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i)), half), shiftCount);
+        __m128i words = _mm_packs_epi32(_mm256_castsi256_si128(values), _mm256_extracti128_si256(values, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), words);
+    }
+    roundInt16RowScalar(destination + i, source + i, shift, count - i);
+}
+
+__attribute__((target("avx2"))) void narrowFixedRowAvx2(uint8_t* destination, const int32_t* source, int shift, int count) {
+    __m128i shiftCount = _mm_cvtsi32_si128(shift);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i values = _mm256_sra_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + i)), shiftCount);
+        __m128i words = _mm_packus_epi32(_mm256_castsi256_si128(values), _mm256_extracti128_si256(values, 1)); // Saturate below 0
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(destination + i), _mm_packus_epi16(words, words)); // Saturate above 255
+    }
+    narrowFixedRowScalar(destination + i, source + i, shift, count - i);
+}
+#endif
+
+// Round weights to FixedPointBits fraction bits, nudging the largest so they still sum to exactly one
+void quantizeWeights(const double* weights, int16_t* quantized, int count) {
+    int sum = 0, largest = 0;
+    for (int i = 0; i < count; ++i) {
+        quantized[i] = static_cast<int16_t>(std::lround(weights[i] * (1 << FixedPointBits)));
+        sum += quantized[i];
+        if (quantized[i] > quantized[largest]) largest = i;
+    }
+    quantized[largest] = static_cast<int16_t>(quantized[largest] + (1 << FixedPointBits) - sum);
+}
+
+// Create an out folder
+void createOutFolder() {
+    const char* dir = "out";
+
+    // Using the OS (probably a better way to do this....)
+    #ifdef _WIN32
+        if (!CreateDirectory(dir, NULL)) {
+            if (GetLastError() == ERROR_ALREADY_EXISTS) {
+                std::cout << "Directory already exists.\n";
+            } else {
+                std::cout << "Failed to create directory.\n";
+            }
+        } else {
+            std::cout << "Directory created successfully.\n";
+        }
+    #else
+        struct stat st;
+        if (stat(dir, &st) != 0) {
+            if (mkdir(dir, 0755) == 0) {
+                std::cout << "Directory created successfully.\n" << std::endl;
+            } else {
+                perror("Failed to create directory");
+            }
+        } else {
+            std::cout << "Directory already exists.\n" << std::endl;
+        }
+    #endif
+}
+
+// Parse the optional --name=value flags that follow the positional arguments
+bool parseOptionalFlags(int argc, char* argv[], int firstFlag) {
+    for (int i = firstFlag; i < argc; ++i) {
+        std::string arg = argv[i];
+        size_t equals = arg.find('=');
+        std::string name = (arg.rfind("--", 0) == 0 && equals != std::string::npos) ? arg.substr(2, equals - 2) : "";
+        if (!setParameter(name, arg.substr(equals + 1))) {
+            std::cerr << "Unknown flag: " << arg << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Set a parameter (any positional argument or optional flag) from its text value (false for unknown names)
+bool setParameter(const std::string& name, const std::string& value) {
+    // Map of parameter names to the handlers that store their values
+    static const std::unordered_map<std::string, std::function<void(const std::string&)>> parameters = {
+        {"sigma", [](const std::string& value) { sigma = std::atof(value.c_str()); }},
+        {"boxSize", [](const std::string& value) { boxSize = std::atoi(value.c_str()); }},
+        {"motionLength", [](const std::string& value) { motionLength = std::atoi(value.c_str()); }},
+        {"bucketFillThreshold", [](const std::string& value) { bucketFillThreshold = std::atoi(value.c_str()); }},
+        {"bucketFillX", [](const std::string& value) { bucketFillX = std::atoi(value.c_str()); }},
+        {"bucketFillY", [](const std::string& value) { bucketFillY = std::atoi(value.c_str()); }},
+        {"resizeWidthBilinear", [](const std::string& value) { resizeWidthBilinear = std::atoi(value.c_str()); }},
+        {"resizeHeightBilinear", [](const std::string& value) { resizeHeightBilinear = std::atoi(value.c_str()); }},
+        {"resizeWidthBicubic", [](const std::string& value) { resizeWidthBicubic = std::atoi(value.c_str()); }},
+        {"resizeHeightBicubic", [](const std::string& value) { resizeHeightBicubic = std::atoi(value.c_str()); }},
+        {"resizeWidthNearestNeighbor", [](const std::string& value) { resizeWidthNearestNeighbor = std::atoi(value.c_str()); }},
+        {"resizeHeightNearestNeighbor", [](const std::string& value) { resizeHeightNearestNeighbor = std::atoi(value.c_str()); }},
+        {"inputImageSize", [](const std::string& value) { inputImageSize = value; }},
+        {"function", [](const std::string& value) { function = value; }},
+        {"separableGaussian", [](const std::string& value) { separableGaussianBlur = std::atoi(value.c_str()) != 0; }},
+        {"motionAngle", [](const std::string& value) { motionAngle = std::atof(value.c_str()); }},
+        {"threads", [](const std::string& value) { threadCount = static_cast<unsigned int>(std::max(std::atoi(value.c_str()), 0)); }},
+        {"tileSize", [](const std::string& value) { tileSize = std::max(std::atoi(value.c_str()), 1); }},
+        {"simd", [](const std::string& value) { useSimd = std::atoi(value.c_str()) != 0; }},
+        {"stream", [](const std::string& value) { streamImages = std::atoi(value.c_str()) != 0; }},
+        {"streamMemory", [](const std::string& value) { streamMemory = std::max(std::atoi(value.c_str()), 1); }},
+        {"batchInput", [](const std::string& value) { batchInput = value; }},
+        {"server", [](const std::string& value) { serverSocket = value; }},
+        {"benchmark", [](const std::string& value) { benchmarkRepetitions = std::max(std::atoi(value.c_str()), 0); }},
+        {"warmup", [](const std::string& value) { benchmarkWarmup = std::max(std::atoi(value.c_str()), 0); }},
+        {"benchmarkOutput", [](const std::string& value) { benchmarkOutput = value; }},
+        {"verify", [](const std::string& value) { verifyMode = value != "0"; }},
+        {"generate", [](const std::string& value) { generateInputs = value != "0"; }},
+        {"manifest", [](const std::string& value) { benchmarkManifest = value; }},
+        {"trace", [](const std::string& value) { traceOutput = value; }},
+        {"counters", [](const std::string& value) { hardwareCounters = value != "0"; }},
+        {"sweep", [](const std::string& value) { sweepThreads = static_cast<unsigned int>(std::max(std::atoi(value.c_str()), 0)); }},
+        {"sweepOutput", [](const std::string& value) { sweepOutput = value; }},
+        {"production", [](const std::string& value) { productionMode = std::atoi(value.c_str()) != 0; }},
+        {"batchOutput", [](const std::string& value) { batchOutput = value; }},
+        {"zeroCopy", [](const std::string& value) { zeroCopyInput = std::atoi(value.c_str()) != 0; }},
+        {"fixedPoint", [](const std::string& value) { fixedPoint = std::atoi(value.c_str()) != 0; }},
+        {"separableResize", [](const std::string& value) { separableResize = std::atoi(value.c_str()) != 0; }},
+        {"resizeWidthLanczos", [](const std::string& value) { resizeWidthLanczos = std::atoi(value.c_str()); }},
+        {"resizeHeightLanczos", [](const std::string& value) { resizeHeightLanczos = std::atoi(value.c_str()); }},
+        {"bucketFillSeeds", [](const std::string& value) {
+            // Comma separated x:y pairs
+            bucketFillSeeds.clear();
+            for (size_t start = 0; start < value.size();) {
+                size_t end = std::min(value.find(',', start), value.size());
+                std::string seed = value.substr(start, end - start);
+                size_t colon = seed.find(':');
+                if (colon != std::string::npos) bucketFillSeeds.push_back({std::atoi(seed.c_str()), std::atoi(seed.c_str() + colon + 1)});
+                start = end + 1;
+            }
+        }}
+    };
+
+    auto parameter = parameters.find(name);
+    if (parameter == parameters.end()) {
+        return false;
+    }
+    parameter->second(value);
+    return true;
+}
+
+// Input file of an inputImageSize: small, medium, large or an entry of the benchmark manifest (false for anything else)
+bool inputFilenameFor(const std::string& size, std::string& filename) {
+    std::vector<ManifestEntry> manifest;
+    if (size == "small" || size == "medium" || size == "large" ||
+        (readManifest(benchmarkManifest, manifest) && std::any_of(manifest.begin(), manifest.end(), [&size](const ManifestEntry& entry) { return entry.name == size; }))) {
+        filename = "in/" + size + "Image.bmp";
+        return true;
+    }
+    return false;
+}
+
+// Helper function for parsing image
+Image parseImageHelper() {
+    // Production mode decodes once, with the fastest reader
+    if (productionMode) {
+        auto start = std::chrono::high_resolution_clock::now();
+        auto image = readBmpMapped(InputFilename, zeroCopyInput);
+        auto end = std::chrono::high_resolution_clock::now();
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+        std::cout << "Time taken for parsing input image (" << (image.width() * image.height()) << "px): " << elapsed.count() << " milliseconds." << std::endl << std::endl;
+        return image;
+    }
+
+    std::cout << "Parsing input image using a single thread..." << std::endl;
+    auto start = std::chrono::high_resolution_clock::now();
+    auto image = readBmpSingleThread(InputFilename);
+    auto end = std::chrono::high_resolution_clock::now();
+    auto elapsedSingle = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    std::cout << "Time taken for parsing input image using a single thread (" << (image.width() * image.height()) << "px): " << elapsedSingle.count() << " milliseconds." << std::endl;
+
+    std::cout << "Parsing input image using multiple threads (memory mapped" << (zeroCopyInput ? ", zero copy" : "") << ")..." << std::endl;
+    start = std::chrono::high_resolution_clock::now();
+    image = readBmpMapped(InputFilename, zeroCopyInput);
+    end = std::chrono::high_resolution_clock::now();
+    auto elapsedMultiple = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    std::cout << "Time taken for parsing input image using multiple threads (" << (image.width() * image.height()) << "px): " << elapsedMultiple.count() << " milliseconds." << std::endl;
+
+    double speedupFactor = static_cast<double>(elapsedSingle.count()) / elapsedMultiple.count();
+
+    std::cout << "Multithreading speedup factor: " << std::fixed << std::setprecision(1) << speedupFactor << "x" << std::endl << std::endl;
+
+    return image;
+}
+
+// Check that a stage can run on row bands of its input, saying why not when it cannot
+bool streamableStage(const PipelineStage& stage) {
+    if (!stage.banded) {
+        // Bucket fill needs the whole image and angled motion lines run across bands
+        std::cerr << "Streaming is not supported for: " << stage.name << (stage.name == "motionBlur" ? " (only with motionAngle=0)" : "") << std::endl;
+    }
+    return stage.banded;
+}
+
+// Helper function for timing and implementing an operation or pipeline in streaming mode (false if it cannot be streamed)
+bool streamHelper(const std::vector<std::string>& names) {
+    std::ifstream input(InputFilename, std::ios::binary | std::ios::ate);
+    if (!input) {
+        std::cerr << "Could not open BMP file!" << std::endl;
+        return false;
+    }
+    uint64_t fileSize = static_cast<uint64_t>(input.tellg());
+    uint8_t header[54] = {};
+    input.seekg(0);
+    input.read(reinterpret_cast<char*>(header), sizeof(header));
+    if (!input) {
+        std::cerr << "Could not read BMP header!" << std::endl;
+        return false;
+    }
+    BmpInfo info;
+    std::vector<PipelineStage> stages;
+    if (!parseBmpHeader(header, fileSize, info) || !planPipeline(names, info.width, info.height, stages)) {
+        return false;
+    }
+    std::string label;
+    for (const auto& stage : stages) {
+        if (!streamableStage(stage)) {
+            return false;
+        }
+        label += (label.empty() ? "" : " -> ") + stage.label;
+    }
+
+    const PipelineStage& last = stages.back();
+    const std::string& outputFilename = stages.size() == 1 ? last.outputFilename : PipelineOutputFilename;
+    std::ofstream output(outputFilename, std::ios::binary);
+    if (!output) {
+        std::cerr << "Could not open output file for writing." << std::endl;
+        return false;
+    }
+    unsigned char outHeader[54];
+    fillBmpHeader(outHeader, last.width, last.height);
+    output.write(reinterpret_cast<const char*>(outHeader), sizeof(outHeader));
+
+    std::cout << "Streaming " << label << " (" << info.width << "x" << info.height << " to " << last.width << "x" << last.height << ", " << streamMemory << " MB bands)..." << std::endl;
+    auto start = std::chrono::high_resolution_clock::now();
+    int bands = 0, bandRows = pipelineBandRows(stages, 0, stages.size(), static_cast<uint64_t>(streamMemory) << 20);
+    for (int startRow = 0; startRow < last.height; startRow += bandRows, ++bands) {
+        // Each band reads just the input rows it needs (with the halos of the filters) and is run in cache sized pieces
+        int endRow = std::min(startRow + bandRows, last.height);
+        auto [firstRow, lastRow] = pipelineInputRows(stages, 0, stages.size(), startRow, endRow);
+        Image band(last.width, endRow - startRow);
+        runPipelineBands(stages, 0, stages.size(), readBmpRows(input, info, firstRow, lastRow - firstRow), firstRow, band, startRow);
+        appendBmpRows(output, band, 0, band.height());
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+
+    if (!input || !output) {
+        std::cerr << "Streaming failed while reading or writing." << std::endl;
+        return false;
+    }
+    std::cout << "Time taken for streaming " << label << " (" << bands << " bands): " << elapsed.count() << " milliseconds." << std::endl;
+    std::cout << "Saved " << label << " output to \"" << outputFilename << "\"" << std::endl << std::endl;
+    return true;
+}
+
+// Helper function for timing and implementing a pipeline of operations with and without fusing them (false if one of them is unknown)
+bool pipelineHelper(const Image& image, const std::vector<std::string>& names) {
+    TraceSpan span("pipeline");
+    std::vector<PipelineStage> stages;
+    if (!planPipeline(names, image.width(), image.height(), stages)) {
+        return false;
+    }
+    std::string label;
+    uint64_t intermediateBytes = 0;
+    for (size_t i = 0; i < stages.size(); ++i) {
+        label += (i == 0 ? "" : " -> ") + stages[i].label;
+        if (i + 1 < stages.size()) intermediateBytes += static_cast<uint64_t>(stages[i].width) * stages[i].height * sizeof(RGB);
+    }
+    const PipelineStage& last = stages.back();
+
+    std::cout << "Running " << label << " one image at a time (" << stages.size() - 1 << " full size intermediate images, " << (intermediateBytes >> 20) << " MB)..." << std::endl;
+    auto start = std::chrono::high_resolution_clock::now();
+    auto pipelineImage = runPipelineUnfused(image, stages);
+    auto end = std::chrono::high_resolution_clock::now();
+    auto elapsedUnfused = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    std::cout << "Time taken for running " << label << " one image at a time: " << elapsedUnfused.count() << " milliseconds." << std::endl;
+    writeBmpMultipleThreads(PipelineOutputFilename, pipelineImage, true, last.width, last.height);
+    std::cout << "Saved pipeline output to \"" << PipelineOutputFilename << "\"" << std::endl;
+
+    std::cout << "Running " << label << " fused into row bands (about " << (PipelineBandBytes >> 10) << " KB per band)..." << std::endl;
+    start = std::chrono::high_resolution_clock::now();
+    pipelineImage = runPipelineFused(image, stages);
+    end = std::chrono::high_resolution_clock::now();
+    auto elapsedFused = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    std::cout << "Time taken for running " << label << " fused into row bands: " << elapsedFused.count() << " milliseconds." << std::endl;
+    writeBmpMultipleThreads(PipelineOutputFilename, pipelineImage, true, last.width, last.height);
+    std::cout << "Saved pipeline output to \"" << PipelineOutputFilename << "\"" << std::endl;
+
+    double speedupFactor = static_cast<double>(elapsedUnfused.count()) / elapsedFused.count();
+
+    std::cout << "Fusion speedup factor: " << std::fixed << std::setprecision(1) << speedupFactor << "x" << std::endl << std::endl;
+    return true;
+}
+
+// Helper function for timing and implementing a function or pipeline over every image of batchInput (false if nothing could be run)
+bool batchHelper(const std::vector<std::string>& names) {
+    if (names.size() == 1 && names[0] == "all") {
+        std::cerr << "Batch mode needs a function or pipeline, not all." << std::endl;
+        return false;
+    }
+    std::vector<std::string> inputs = listBatchInputs(batchInput);
+    if (inputs.empty()) {
+        std::cerr << "No BMP files found in: " << batchInput << std::endl;
+        return false;
+    }
+    std::error_code error;
+    std::filesystem::create_directories(batchOutput, error);
+    if (error) {
+        std::cerr << "Could not create batch output directory: " << batchOutput << std::endl;
+        return false;
+    }
+    std::vector<PipelineStage> stages;
+    if (!planPipeline(names, 1, 1, stages)) { // Catches unknown functions before any image is read
+        return false;
+    }
+
+    // Large images are split across the threads, small ones (the common case) are run whole on one thread each so nothing is split finer than it is worth
+    std::vector<std::string> smallInputs, largeInputs;
+    for (const auto& input : inputs) {
+        uint64_t bytes = std::filesystem::file_size(input, error);
+        (!error && bytes >= BatchLargeImageBytes ? largeInputs : smallInputs).push_back(input);
+    }
+    auto outputFor = [](const std::string& input) { return (std::filesystem::path(batchOutput) / std::filesystem::path(input).filename()).string(); };
+    auto runPipeline = [&names](const Image& image, std::vector<PipelineStage>& stages) {
+        return planPipeline(names, image.width(), image.height(), stages) ? runPipelineFused(image, stages) : Image();
+    };
+    std::atomic<int> failed{0};
+
+    std::cout << "Processing " << inputs.size() << " images from \"" << batchInput << "\" (" << smallInputs.size() << " a thread each, " << largeInputs.size() << " split across " << ThreadPool::instance().size() << " threads)..." << std::endl;
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // Small images: every thread decodes, filters and encodes whole images (the operations' own parallelFor calls run inline), so one thread's reads and writes overlap the others' filtering
+    ThreadPool::instance().parallelForTiles(1, static_cast<int>(smallInputs.size()), 1, 1, [&](int, int startImage, int, int endImage) {
+        std::vector<PipelineStage> imageStages;
+        for (int i = startImage; i < endImage; ++i) {
+            Image image = readBmpMapped(smallInputs[i], true); // Only read, so the mapped pixels are used in place
+            Image output = image.empty() ? Image() : runPipeline(image, imageStages);
+            if (output.empty()) {
+                std::cerr << "Skipping \"" << smallInputs[i] << "\"" << std::endl;
+                ++failed;
+                continue;
+            }
+            writeBmp(outputFor(smallInputs[i]), output, true, output.width(), output.height());
+        }
+    });
+
+    // Large images: one at a time on all the threads, with the next one read and the previous one written in the background
+    std::future<Image> next;
+    std::future<void> written;
+    if (!largeInputs.empty()) {
+        next = std::async(std::launch::async, readBmpMapped, largeInputs[0], false);
+    }
+    for (size_t i = 0; i < largeInputs.size(); ++i) {
+        Image image = next.get();
+        if (i + 1 < largeInputs.size()) {
+            next = std::async(std::launch::async, readBmpMapped, largeInputs[i + 1], false);
+        }
+        Image output = image.empty() ? Image() : runPipeline(image, stages);
+        if (written.valid()) {
+            written.get(); // At most one output waiting to be written
+        }
+        if (output.empty()) {
+            std::cerr << "Skipping \"" << largeInputs[i] << "\"" << std::endl;
+            ++failed;
+            continue;
+        }
+        written = std::async(std::launch::async, [output = std::move(output), filename = outputFor(largeInputs[i])] {
+            writeBmp(filename, output, true, output.width(), output.height());
+        });
+    }
+    if (written.valid()) {
+        written.get();
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    double imagesPerSecond = inputs.size() * 1000.0 / std::max<long long>(elapsed.count(), 1);
+    std::cout << "Time taken for processing " << inputs.size() << " images: " << elapsed.count() << " milliseconds (" << std::fixed << std::setprecision(1) << imagesPerSecond << " images per second, " << failed << " failed)." << std::endl;
+    std::cout << "Saved batch outputs to \"" << batchOutput << "\"" << std::endl << std::endl;
+    return failed < static_cast<int>(inputs.size());
+}
+
+// BMP files of a batch: the .bmp files of a directory (sorted) or the paths listed in a file
+std::vector<std::string> listBatchInputs(const std::string& path) {
+    std::vector<std::string> inputs;
+    std::error_code error;
+    if (std::filesystem::is_directory(path, error)) {
+        for (const auto& entry : std::filesystem::directory_iterator(path, error)) {
+            std::string extension = entry.path().extension().string();
+            std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+            if (entry.is_regular_file(error) && extension == ".bmp") {
+                inputs.push_back(entry.path().string());
+            }
+        }
+        std::sort(inputs.begin(), inputs.end());
+        return inputs;
+    }
+
+    std::ifstream list(path);
+    for (std::string line; std::getline(list, line);) {
+        line.erase(line.find_last_not_of(" \t\r") + 1); // Tolerate trailing whitespace and CRLF lists
+        if (!line.empty()) {
+            inputs.push_back(line);
+        }
+    }
+    return inputs;
+}
+
+// Helper function for checking every implementation variant against its reference on seeded synthetic images at many sizes, parameters and thread counts (false if any disagree)
+bool verifyHelper() {
+    // Thread counts and tile sizes the variants run with (8 threads give the short images fewer rows than threads, 7 pixel tiles leave ragged edges)
+    const std::vector<std::pair<unsigned int, int>> configurations = {{1, 64}, {3, 7}, {8, 64}};
+    const std::vector<std::pair<int, int>> sizes = {{1, 1}, {1, 7}, {7, 1}, {2, 3}, {5, 2}, {17, 13}, {64, 9}, {131, 67}};
+    const char* profileNames[] = {"gradient", "noise", "flat"};
+    const std::string bmpFilename = "out/verify.bmp", copyFilename = "out/verifyCopy.bmp";
+
+    // The parameters and switches are globals, so each check sets what it needs and everything is put back at the end
+    auto saved = std::make_tuple(sigma, boxSize, motionLength, motionAngle, bucketFillThreshold, bucketFillX, bucketFillY, tileSize, useSimd, fixedPoint, separableGaussianBlur, separableResize);
+    ThreadPool& pool = ThreadPool::instance();
+    unsigned int originalThreads = pool.size();
+
+    int checks = 0, failures = 0;
+    std::string context;
+    // Exact when maxError is 0, otherwise within maxError of the reference on every channel and VerifyPsnrBound dB overall
+    auto check = [&](const std::string& variant, const Image& expected, const Image& actual, int maxError) {
+        ++checks;
+        auto [error, psnr] = compareImages(expected, actual);
+        if (error >= 0 && error <= maxError && (maxError == 0 || psnr >= VerifyPsnrBound)) return;
+        ++failures;
+        std::cout << std::fixed << std::setprecision(1) << "FAIL " << variant << " on " << context << ": ";
+        if (error < 0) {
+            std::cout << actual.width() << "x" << actual.height() << " instead of " << expected.width() << "x" << expected.height() << std::endl;
+        } else {
+            std::cout << "max error " << error << " (bound " << maxError << "), PSNR " << psnr << " dB" << std::endl;
+        }
+    };
+
+    // The kernels baked at compile time are the ones generated at run time bit for bit
+    for (const auto& baked : BakedGaussianKernels) {
+        ++checks;
+        if (*gaussianKernel1DFor(baked.sigma) != generateGaussianKernel1D(baked.sigma) || *gaussianKernel2DFor(baked.sigma) != generateGaussianKernelSingleThread(baked.sigma)) {
+            ++failures;
+            std::cout << "FAIL baked Gaussian kernel of sigma " << baked.sigma << " differs from the generated one" << std::endl;
+        }
+    }
+
+    std::cout << "Verifying every implementation on " << sizes.size() * 3 << " synthetic images with " << configurations.size() << " thread and tile configurations..." << std::endl;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (const auto& [threads, tile] : configurations) {
+        pool.resize(threads);
+        tileSize = tile;
+        for (size_t i = 0; i < sizes.size(); ++i) {
+            for (int profile = 0; profile < 3; ++profile) {
+                auto [width, height] = sizes[i];
+                Image image(width, height);
+                fillSyntheticRows(image, static_cast<SyntheticProfile>(profile), height, 0, i * 3 + profile + 1);
+                std::string imageName = std::to_string(width) + "x" + std::to_string(height) + " " + profileNames[profile] + ", " + std::to_string(threads) + " threads, tile " + std::to_string(tile);
+
+                // Parsing and writing round trip the image exactly
+                context = imageName;
+                writeBmp(bmpFilename, image, false);
+                writeBmpMultipleThreads(copyFilename, image, false);
+                check("readBmpSingleThread", image, readBmpSingleThread(bmpFilename), 0);
+                check("readBmpMultipleThreads", image, readBmpMultipleThreads(bmpFilename), 0);
+                check("readBmpMapped", image, readBmpMapped(bmpFilename, false), 0);
+                check("readBmpMapped zero copy", image, readBmpMapped(bmpFilename, true), 0);
+                check("writeBmpMultipleThreads", image, readBmpSingleThread(copyFilename), 0);
+
+                // The float and fixed point separable blurs approximate the full 2D convolution, the vector kernels match the scalar ones exactly
+                for (double s : {0.8, 3.0}) {
+                    sigma = s;
+                    context = imageName + ", sigma " + std::to_string(s);
+                    Image reference = applyGaussianBlurSingleThread(image, generateGaussianKernelSingleThread(s));
+                    check("applyGaussianBlurMultipleThreads", reference, applyGaussianBlurMultipleThreads(image, *gaussianKernel2DFor(s)), 0);
+                    for (bool simd : {false, true}) {
+                        useSimd = simd;
+                        std::string kernels = simd ? " (simd)" : " (scalar)";
+                        fixedPoint = false;
+                        Image separable = applySeparableGaussianBlurSingleThread(image, generateGaussianKernel1D(s));
+                        check("applySeparableGaussianBlurSingleThread" + kernels, reference, separable, 1);
+                        check("applySeparableGaussianBlurMultipleThreads" + kernels, separable, applySeparableGaussianBlurMultipleThreads(image, *gaussianKernel1DFor(s)), 0);
+                        fixedPoint = true;
+                        check("applySeparableGaussianBlurMultipleThreads fixed point" + kernels, separable, applySeparableGaussianBlurMultipleThreads(image, *gaussianKernel1DFor(s)), 2);
+                    }
+                    fixedPoint = false;
+                }
+
+                for (int size : {1, 3, 9}) {
+                    context = imageName + ", box " + std::to_string(size);
+                    Image reference = applyBoxBlurSingleThread(image, size);
+                    for (bool simd : {false, true}) {
+                        useSimd = simd;
+                        check(std::string("applyBoxBlurMultipleThreads") + (simd ? " (simd)" : " (scalar)"), reference, applyBoxBlurMultipleThreads(image, size), 0);
+                    }
+                }
+
+                for (auto [length, angle] : std::vector<std::pair<int, double>>{{1, 0.0}, {15, 0.0}, {9, 30.0}, {7, 90.0}}) {
+                    context = imageName + ", motion " + std::to_string(length) + " at " + std::to_string(angle);
+                    check("applyMotionBlurMultipleThreads", applyMotionBlurSingleThread(image, length, angle), applyMotionBlurMultipleThreads(image, length, angle), 0);
+                }
+
+                for (int threshold : {0, 75}) {
+                    for (auto [x, y] : std::vector<std::pair<int, int>>{{0, 0}, {width / 2, height / 2}}) {
+                        bucketFillThreshold = threshold;
+                        bucketFillX = x;
+                        bucketFillY = y;
+                        context = imageName + ", threshold " + std::to_string(threshold) + " from " + std::to_string(x) + "," + std::to_string(y);
+                        Image reference = applyBucketFillSingleThread(image, threshold);
+                        check("applyBucketFillMultipleThreads", reference, applyBucketFillMultipleThreads(image, threshold), 0);
+                        check("applyBucketFillIndexed", reference, applyBucketFillIndexed(image, threshold, {{x, y}}), 0);
+                    }
+                }
+
+                // Down, up and to a single pixel (the separable resizes resample the direct ones, the fixed point passes approximate the float ones)
+                for (auto [newWidth, newHeight] : std::vector<std::pair<int, int>>{{width / 2 + 1, height / 3 + 1}, {width * 2 + 1, height * 2 + 1}, {1, 1}}) {
+                    context = imageName + " to " + std::to_string(newWidth) + "x" + std::to_string(newHeight);
+                    check("nearestNeighborResizeMultipleThreads", nearestNeighborResizeSingleThread(image, newWidth, newHeight), nearestNeighborResizeMultipleThreads(image, newWidth, newHeight), 0);
+                    std::vector<std::tuple<std::string, ResizeFilter, std::function<Image(const Image&, int, int)>, std::function<Image(const Image&, int, int)>>> resizes = {
+                        {"Bilinear", ResizeFilter::Bilinear, resizeBilinearSingleThread, resizeBilinearMultipleThreads},
+                        {"Bicubic", ResizeFilter::Bicubic, resizeBicubicSingleThread, resizeBicubicMultipleThreads},
+                        {"Lanczos", ResizeFilter::Lanczos3, nullptr, nullptr}
+                    };
+                    for (const auto& [name, filter, single, multiple] : resizes) {
+                        auto plan = resizePlanFor(filter, width, height, newWidth, newHeight);
+                        fixedPoint = false;
+                        Image separable = resizeSeparableSingleThread(image, *plan);
+                        if (single) {
+                            Image reference = single(image, newWidth, newHeight);
+                            check("resize" + name + "MultipleThreads", reference, multiple(image, newWidth, newHeight), 0);
+                            check("resizeSeparableSingleThread " + name, reference, separable, 1);
+                            fixedPoint = true;
+                            check("resize" + name + "MultipleThreads fixed point", reference, multiple(image, newWidth, newHeight), 2);
+                            fixedPoint = false;
+                        }
+                        check("resizeSeparableMultipleThreads " + name, separable, resizeSeparableMultipleThreads(image, *plan), 0);
+                        fixedPoint = true;
+                        check("resizeSeparableMultipleThreads fixed point " + name, separable, resizeSeparableMultipleThreads(image, *plan), 2);
+                        fixedPoint = false;
+                    }
+                }
+
+                // Fusing a pipeline into bands gives the same pixels as running it one image at a time
+                sigma = 3.0;
+                boxSize = 5;
+                motionLength = 9;
+                motionAngle = 0.0;
+                bucketFillX = bucketFillY = 0;
+                for (auto names : std::vector<std::vector<std::string>>{{"boxBlur", "gaussianBlur", "bilinearResize"}, {"motionBlur", "lanczosResize", "boxBlur"}, {"gaussianBlur", "bucketFill", "bicubicResize"}}) {
+                    std::vector<PipelineStage> stages;
+                    context = imageName + ", pipeline " + names[0] + "," + names[1] + "," + names[2];
+                    if (planPipeline(names, width, height, stages)) {
+                        check("runPipelineFused", runPipelineUnfused(image, stages), runPipelineFused(image, stages), 0);
+                    }
+                }
+            }
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+
+    std::tie(sigma, boxSize, motionLength, motionAngle, bucketFillThreshold, bucketFillX, bucketFillY, tileSize, useSimd, fixedPoint, separableGaussianBlur, separableResize) = saved;
+    pool.resize(originalThreads);
+    std::remove(bmpFilename.c_str());
+    std::remove(copyFilename.c_str());
+
+    std::cout << "Time taken for verifying: " << elapsed.count() << " milliseconds." << std::endl;
+    std::cout << checks - failures << " of " << checks << " checks passed" << (failures ? ", " + std::to_string(failures) + " failed" : "") << std::endl << std::endl;
+    return failures == 0;
+}
+
+// Largest per channel difference between two images (-1 if their sizes differ), and their PSNR in dB (infinite when equal)
+std::pair<int, double> compareImages(const Image& expected, const Image& actual) {
+    if (expected.width() != actual.width() || expected.height() != actual.height()) {
+        return {-1, 0.0};
+    }
+    int maxError = 0;
+    double squares = 0.0;
+    for (int y = 0; y < expected.height(); ++y) {
+        const uint8_t* a = reinterpret_cast<const uint8_t*>(expected.row(y));
+        const uint8_t* b = reinterpret_cast<const uint8_t*>(actual.row(y));
+        for (size_t i = 0; i < expected.rowBytes(); ++i) {
+            int error = std::abs(a[i] - b[i]);
+            maxError = std::max(maxError, error);
+            squares += error * error;
+        }
+    }
+    double meanSquare = squares / (static_cast<double>(expected.rowBytes()) * expected.height());
+    return {maxError, meanSquare == 0.0 ? std::numeric_limits<double>::infinity() : 10.0 * std::log10(255.0 * 255.0 / meanSquare)};
+}
+
+// Helper function for writing the synthetic input of the benchmark manifest inputImageSize names, or all of them for all (false if there is no such entry or an image could not be written)
+bool generateHelper() {
+    std::vector<ManifestEntry> entries;
+    if (!readManifest(benchmarkManifest, entries)) {
+        std::cerr << "Could not read benchmark manifest: " << benchmarkManifest << std::endl;
+        return false;
+    }
+    // Only the entry inputImageSize names is written, every entry (the 16k ones are hundreds of MB each) only with inputImageSize=all
+    if (inputImageSize != "all") {
+        entries.erase(std::remove_if(entries.begin(), entries.end(), [](const ManifestEntry& entry) { return entry.name != inputImageSize; }), entries.end());
+        if (entries.empty()) {
+            std::cerr << "No entry named " << inputImageSize << " in benchmark manifest: " << benchmarkManifest << " (set inputImageSize to one of its names, or all)" << std::endl;
+            return false;
+        }
+    }
+    const char* profileNames[] = {"gradient", "noise", "flat"};
+    for (const auto& entry : entries) {
+        std::string filename = "in/" + entry.name + "Image.bmp";
+        std::cout << "Generating " << profileNames[static_cast<int>(entry.profile)] << " image " << entry.width << "x" << entry.height << " (seed " << entry.seed << ")..." << std::endl;
+        auto start = std::chrono::high_resolution_clock::now();
+        if (!generateBmp(filename, entry.profile, entry.width, entry.height, entry.seed)) {
+            std::cerr << "Could not write generated image to: " << filename << std::endl;
+            return false;
+        }
+        auto end = std::chrono::high_resolution_clock::now();
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+        std::cout << "Time taken for generating " << entry.name << " (" << static_cast<int64_t>(entry.width) * entry.height << "px): " << elapsed.count() << " milliseconds." << std::endl;
+        std::cout << "Saved generated image to \"" << filename << "\"" << std::endl << std::endl;
+    }
+    return true;
+}
+
+// Entries of a benchmark manifest (false if it cannot be read or a line is malformed)
+bool readManifest(const std::string& filename, std::vector<ManifestEntry>& entries) {
+    std::ifstream manifest(filename);
+    if (!manifest) {
+        return false;
+    }
+    const std::unordered_map<std::string, SyntheticProfile> profiles = {
+        {"gradient", SyntheticProfile::Gradient}, {"noise", SyntheticProfile::Noise}, {"flat", SyntheticProfile::Flat}
+    };
+    std::string line;
+    while (std::getline(manifest, line)) {
+        // Blank lines and # comments are skipped
+        std::istringstream fields(line.substr(0, line.find('#')));
+        std::string name, profile;
+        ManifestEntry entry;
+        if (!(fields >> name)) continue;
+        if (!(fields >> profile >> entry.width >> entry.height >> entry.seed) || profiles.count(profile) == 0 || entry.width <= 0 || entry.height <= 0) {
+            std::cerr << "Malformed benchmark manifest line: " << line << std::endl;
+            return false;
+        }
+        entry.name = name;
+        entry.profile = profiles.at(profile);
+        entries.push_back(entry);
+    }
+    return true;
+}
+
+// Write a seeded synthetic 24 bit BMP a band of rows at a time, so its size is not limited by memory
+bool generateBmp(const std::string& filename, SyntheticProfile profile, int width, int height, uint64_t seed) {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    unsigned char header[54];
+    fillBmpHeader(header, width, height);
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+    int bandRows = static_cast<int>(std::clamp<uint64_t>((static_cast<uint64_t>(streamMemory) << 20) / (static_cast<uint64_t>(width) * sizeof(RGB)), 1, static_cast<uint64_t>(height)));
+    for (int startRow = 0; startRow < height && file; startRow += bandRows) {
+        Image band(width, std::min(bandRows, height - startRow));
+        fillSyntheticRows(band, profile, height, startRow, seed);
+        appendBmpRows(file, band, 0, band.height());
+    }
+    return static_cast<bool>(file);
+}
+
+// Fill the rows of an image with rows [firstRow, firstRow + rows.height()) of a synthetic image of the given height (and the rows' width)
+void fillSyntheticRows(Image& rows, SyntheticProfile profile, int height, int firstRow, uint64_t seed) {
+    int width = rows.width();
+    // Flat regions are big enough that a bucket fill from any seed covers a sizeable part of the image
+    int cellSize = std::max(2, std::min(width, height) / 8);
+    uint64_t phase = mixBits(seed) % 510;
+    auto pixelAt = [&](int x, int y) -> RGB {
+        switch (profile) {
+        case SyntheticProfile::Gradient: {
+            // Red and green ramp across the axes, blue is a triangle wave along the diagonal shifted by the seed
+            int diagonal = static_cast<int>((static_cast<int64_t>(x + y) * 1020 / (width + height) + phase) % 510);
+            return {static_cast<uint8_t>(diagonal < 256 ? diagonal : 509 - diagonal), static_cast<uint8_t>(static_cast<int64_t>(y) * 255 / std::max(height - 1, 1)),
+                    static_cast<uint8_t>(static_cast<int64_t>(x) * 255 / std::max(width - 1, 1))};
+        }
+        case SyntheticProfile::Noise: {
+            uint64_t bits = mixBits(seed ^ (static_cast<uint64_t>(y) * width + x) * 0x9E3779B97F4A7C15ull);
+            return {static_cast<uint8_t>(bits), static_cast<uint8_t>(bits >> 8), static_cast<uint8_t>(bits >> 16)};
+        }
+        case SyntheticProfile::Flat: {
+            // Four levels per channel, so neighbouring cells are usually far apart in color
+            uint64_t bits = mixBits(seed ^ ((static_cast<uint64_t>(y / cellSize) << 32) | static_cast<uint32_t>(x / cellSize)));
+            return {static_cast<uint8_t>((bits & 3) * 85), static_cast<uint8_t>((bits >> 2 & 3) * 85), static_cast<uint8_t>((bits >> 4 & 3) * 85)};
+        }
+        }
+        return {0, 0, 0};
+    };
+
+    ThreadPool::instance().parallelFor(rows.height(), [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            RGB* row = rows.row(y);
+            for (int x = 0; x < width; ++x) {
+                row[x] = pixelAt(x, firstRow + y);
+            }
+        }
+    });
+}
+
+// Mix a 64 bit value into well spread bits (splitmix64), so every synthetic pixel depends only on the seed and its position
+uint64_t mixBits(uint64_t value) {
+    value += 0x9E3779B97F4A7C15ull;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+    return value ^ (value >> 31);
+}
+
+// Helper function for benchmarking every implementation of the functions (or a pipeline) and writing the report to benchmarkOutput (false if nothing could be run)
+bool benchmarkHelper(const std::vector<std::string>& names) {
+    Image image = readBmpMapped(InputFilename, false);
+    if (image.empty()) {
+        return false;
+    }
+    std::vector<BenchmarkCase> cases = benchmarkCases(image, names);
+    if (cases.empty()) {
+        return false;
+    }
+
+    std::cout << "Benchmarking on " << cpuModel() << " with " << ThreadPool::instance().size() << " threads (" << image.width() << "x" << image.height() << ", " << benchmarkWarmup << " warmup and " << benchmarkRepetitions << " timed runs each)..." << std::endl;
+    if (hardwareCounters && !PerfCounters::forThisThread().available()) {
+        std::cerr << "Hardware counters are not available (perf_event_open is Linux only and needs kernel.perf_event_paranoid <= 2 and a PMU), timing only" << std::endl;
+    }
+    std::vector<BenchmarkResult> results;
+    for (const auto& benchmarkCase : cases) {
+        results.push_back(runBenchmark(benchmarkCase, benchmarkWarmup, benchmarkRepetitions));
+        BenchmarkResult& result = results.back();
+        std::cout << std::fixed << std::setprecision(3) << result.operation << " (" << result.implementation << "): median " << result.medianNs / 1e6 << " ms, min " << result.minNs / 1e6 << " ms, p95 " << result.p95Ns / 1e6 << " ms, stddev " << result.stddevNs / 1e6 << " ms" << std::endl;
+        if (hardwareCounters && countBenchmark(benchmarkCase, result)) {
+            printCounters(result, static_cast<int64_t>(image.width()) * image.height());
+        }
+
+        // Speedups against the first implementation of the same operation, from the medians (nanoseconds never round down to zero like milliseconds did)
+        const BenchmarkResult& baseline = *std::find_if(results.begin(), results.end(), [&](const BenchmarkResult& other) { return other.operation == result.operation; });
+        if (&baseline != &result) {
+            std::cout << std::setprecision(2) << "Speedup factor over " << baseline.implementation << ": " << static_cast<double>(baseline.medianNs) / std::max<int64_t>(result.medianNs, 1) << "x" << std::endl;
+        }
+    }
+
+    if (!writeBenchmarkReport(benchmarkOutput, image, results)) {
+        std::cerr << "Could not write benchmark report to: " << benchmarkOutput << std::endl;
+        return false;
+    }
+    std::cout << "Saved benchmark report to \"" << benchmarkOutput << "\"" << std::endl << std::endl;
+    return true;
+}
+
+// Benchmark cases for the functions (parsing, then the single and multiple thread implementations of each, or a pipeline with and without fusion)
+std::vector<BenchmarkCase> benchmarkCases(const Image& image, const std::vector<std::string>& names) {
+    std::vector<BenchmarkCase> cases = {
+        {"parse", "singleThread", [] { readBmpSingleThread(InputFilename); }},
+        {"parse", "multipleThreads", [] { readBmpMapped(InputFilename, zeroCopyInput); }}
+    };
+
+    // A pipeline is compared fused against one image per stage
+    if (names.size() > 1) {
+        auto stages = std::make_shared<std::vector<PipelineStage>>();
+        if (!planPipeline(names, image.width(), image.height(), *stages)) {
+            return {};
+        }
+        std::string operation;
+        for (const auto& name : names) {
+            operation += (operation.empty() ? "" : ",") + name;
+        }
+        cases.push_back({operation, "unfused", [&image, stages] { runPipelineUnfused(image, *stages); }});
+        cases.push_back({operation, "fused", [&image, stages] { runPipelineFused(image, *stages); }});
+        return cases;
+    }
+
+    // The same implementations the helpers compare, so the numbers line up with a normal run
+    auto plan = [&image](ResizeFilter filter, int width, int height) { return resizePlanFor(filter, image.width(), image.height(), width, height); };
+    std::vector<std::pair<std::string, std::vector<std::pair<std::string, std::function<void()>>>>> operations = {
+        {"gaussianBlur", {
+            {"singleThread", [&image] { separableGaussianBlur ? applySeparableGaussianBlurSingleThread(image, generateGaussianKernel1D(sigma)) : applyGaussianBlurSingleThread(image, generateGaussianKernelSingleThread(sigma)); }},
+            {"multipleThreads", [&image] { separableGaussianBlur ? applySeparableGaussianBlurMultipleThreads(image, *gaussianKernel1DFor(sigma)) : applyGaussianBlurMultipleThreads(image, *gaussianKernel2DFor(sigma)); }}}},
+        {"boxBlur", {
+            {"singleThread", [&image] { applyBoxBlurSingleThread(image, boxSize); }},
+            {"multipleThreads", [&image] { applyBoxBlurMultipleThreads(image, boxSize); }}}},
+        {"motionBlur", {
+            {"singleThread", [&image] { applyMotionBlurSingleThread(image, motionLength, motionAngle); }},
+            {"multipleThreads", [&image] { applyMotionBlurMultipleThreads(image, motionLength, motionAngle); }}}},
+        {"bucketFill", {
+            {"singleThread", [&image] { applyBucketFillSingleThread(image, bucketFillThreshold); }},
+            {"multipleThreads", [&image] { applyBucketFillMultipleThreads(image, bucketFillThreshold); }},
+            {"regionIndex", [&image] { applyBucketFillIndexed(image, bucketFillThreshold, {{bucketFillX, bucketFillY}}); }}}}, // Cached by the warmup runs, so this times the lookup
+        {"bilinearResize", {
+            {"singleThread", [&image, plan] { separableResize ? resizeSeparableSingleThread(image, *plan(ResizeFilter::Bilinear, resizeWidthBilinear, resizeHeightBilinear)) : resizeBilinearSingleThread(image, resizeWidthBilinear, resizeHeightBilinear); }},
+            {"multipleThreads", [&image, plan] { separableResize ? resizeSeparableMultipleThreads(image, *plan(ResizeFilter::Bilinear, resizeWidthBilinear, resizeHeightBilinear)) : resizeBilinearMultipleThreads(image, resizeWidthBilinear, resizeHeightBilinear); }}}},
+        {"bicubicResize", {
+            {"singleThread", [&image, plan] { separableResize ? resizeSeparableSingleThread(image, *plan(ResizeFilter::Bicubic, resizeWidthBicubic, resizeHeightBicubic)) : resizeBicubicSingleThread(image, resizeWidthBicubic, resizeHeightBicubic); }},
+            {"multipleThreads", [&image, plan] { separableResize ? resizeSeparableMultipleThreads(image, *plan(ResizeFilter::Bicubic, resizeWidthBicubic, resizeHeightBicubic)) : resizeBicubicMultipleThreads(image, resizeWidthBicubic, resizeHeightBicubic); }}}},
+        {"nearestNeighborResize", {
+            {"singleThread", [&image] { nearestNeighborResizeSingleThread(image, resizeWidthNearestNeighbor, resizeHeightNearestNeighbor); }},
+            {"multipleThreads", [&image] { nearestNeighborResizeMultipleThreads(image, resizeWidthNearestNeighbor, resizeHeightNearestNeighbor); }}}},
+        {"lanczosResize", {
+            {"singleThread", [&image, plan] { resizeSeparableSingleThread(image, *plan(ResizeFilter::Lanczos3, resizeWidthLanczos, resizeHeightLanczos)); }},
+            {"multipleThreads", [&image, plan] { resizeSeparableMultipleThreads(image, *plan(ResizeFilter::Lanczos3, resizeWidthLanczos, resizeHeightLanczos)); }}}}
+    };
+
+    bool found = false;
+    for (const auto& [operation, implementations] : operations) {
+        if (names[0] != "all" && names[0] != operation) continue;
+        found = true;
+        for (const auto& [implementation, run] : implementations) {
+            cases.push_back({operation, implementation, run});
+        }
+    }
+    if (!found) {
+        std::cerr << "Unknown function: " << names[0] << std::endl;
+        return {};
+    }
+    return cases;
+}
+
+// Run a case warmup times untimed and repetitions times timed
+BenchmarkResult runBenchmark(const BenchmarkCase& benchmarkCase, int warmup, int repetitions) {
+    for (int i = 0; i < warmup; ++i) {
+        benchmarkCase.run();
+    }
+    std::vector<int64_t> samples(repetitions);
+    for (auto& sample : samples) {
+        auto start = std::chrono::steady_clock::now();
+        benchmarkCase.run();
+        sample = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Nearest rank percentiles over the sorted samples, sample standard deviation
+    std::sort(samples.begin(), samples.end());
+    double mean = 0.0, squares = 0.0;
+    for (int64_t sample : samples) mean += static_cast<double>(sample) / repetitions;
+    for (int64_t sample : samples) squares += (sample - mean) * (sample - mean);
+    auto rank = [&](double fraction) { return samples[std::min(static_cast<size_t>(std::ceil(fraction * repetitions)), samples.size()) - 1]; };
+    int64_t median = repetitions % 2 ? samples[repetitions / 2] : (samples[repetitions / 2 - 1] + samples[repetitions / 2]) / 2;
+    BenchmarkResult result; // The counter fields keep their defaults until countBenchmark fills them in
+    result.operation = benchmarkCase.operation;
+    result.implementation = benchmarkCase.implementation;
+    result.minNs = samples.front();
+    result.medianNs = median;
+    result.p95Ns = rank(0.95);
+    result.meanNs = mean;
+    result.stddevNs = repetitions > 1 ? std::sqrt(squares / (repetitions - 1)) : 0.0;
+    return result;
+}
+
+// Run a case once more with the hardware counters on, for the whole operation and for each pool thread's share of it (false if no counter is available)
+bool countBenchmark(const BenchmarkCase& benchmarkCase, BenchmarkResult& result) {
+    PerfCounters& counters = PerfCounters::forThisThread();
+    if (!counters.available()) {
+        return false;
+    }
+    ThreadPool& pool = ThreadPool::instance();
+    int64_t waitNs = 0;
+    pool.takeChunkCounters(waitNs); // Start from zero
+    pool.countChunks(true);
+    CounterValues before = counters.read();
+    auto start = std::chrono::steady_clock::now();
+    benchmarkCase.run();
+    result.countedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    CounterValues calling = counters.read() - before;
+    pool.countChunks(false);
+    result.threadCounters = pool.takeChunkCounters(waitNs);
+
+    // The calling thread counts the whole run (its own chunks included), the workers only their chunks
+    calling.busyNs = result.countedNs - waitNs;
+    result.threadCounters[0] = calling;
+    result.counters = CounterValues();
+    for (const auto& thread : result.threadCounters) {
+        result.counters += thread;
+    }
+    result.counted = true;
+    return true;
+}
+
+// Print the counters of a counted benchmark result: IPC, memory traffic per pixel and each thread's busy and idle time
+void printCounters(const BenchmarkResult& result, int64_t pixels) {
+    const CounterValues& total = result.counters;
+    std::cout << std::setprecision(2) << "Counters: IPC " << static_cast<double>(total.instructions) / std::max<uint64_t>(total.cycles, 1) << " (" << total.instructions << " instructions, " << total.cycles << " cycles), LLC misses "
+              << total.llcMisses << " (" << total.llcMisses * 64.0 / std::max<int64_t>(pixels, 1) << " bytes/px), dTLB misses " << total.dtlbMisses << ", branch misses " << total.branchMisses << std::endl;
+    std::cout << std::setprecision(0) << "Busy/idle per thread:";
+    for (size_t i = 0; i < result.threadCounters.size(); ++i) {
+        double busy = 100.0 * result.threadCounters[i].busyNs / std::max<int64_t>(result.countedNs, 1);
+        std::cout << " " << i << ": " << busy << "%/" << 100.0 - busy << "%";
+    }
+    std::cout << std::endl;
+}
+
+// Write benchmark results with the machine and input they were measured on as JSON or CSV (by the file extension)
+bool writeBenchmarkReport(const std::string& filename, const Image& image, const std::vector<BenchmarkResult>& results) {
+    std::ofstream report(filename);
+    if (!report) {
+        return false;
+    }
+    std::string cpu = cpuModel();
+    unsigned int threads = ThreadPool::instance().size();
+    bool csv = filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".csv") == 0;
+    report << std::fixed << std::setprecision(1);
+
+    if (csv) {
+        // One row per case with the run's details repeated, so files from several runs can be concatenated
+        report << "cpu,threads,rowKernels,input,width,height,warmup,repetitions,operation,implementation,minNs,medianNs,p95Ns,meanNs,stddevNs"
+               << (hardwareCounters ? ",cycles,instructions,llcMisses,dtlbMisses,branchMisses,countedNs,threadBusyNs" : "") << "\n";
+        for (const auto& result : results) {
+            report << csvField(cpu) << "," << threads << "," << rowKernels().name << "," << csvField(InputFilename) << "," << image.width() << "," << image.height() << "," << benchmarkWarmup << "," << benchmarkRepetitions << ","
+                   << csvField(result.operation) << "," << result.implementation << "," << result.minNs << "," << result.medianNs << "," << result.p95Ns << "," << result.meanNs << "," << result.stddevNs;
+            if (hardwareCounters) {
+                // Per thread busy times are joined with semicolons (empty without counters)
+                const CounterValues& total = result.counters;
+                std::string busy;
+                for (const auto& thread : result.threadCounters) busy += (busy.empty() ? "" : ";") + std::to_string(thread.busyNs);
+                report << "," << total.cycles << "," << total.instructions << "," << total.llcMisses << "," << total.dtlbMisses << "," << total.branchMisses << "," << result.countedNs << "," << busy;
+            }
+            report << "\n";
+        }
+    } else {
+        report << "{\n";
+        report << "  \"cpu\": " << jsonString(cpu) << ",\n";
+        report << "  \"threads\": " << threads << ",\n";
+        report << "  \"rowKernels\": " << jsonString(rowKernels().name) << ",\n";
+        report << "  \"input\": " << jsonString(InputFilename) << ",\n";
+        report << "  \"width\": " << image.width() << ",\n";
+        report << "  \"height\": " << image.height() << ",\n";
+        report << "  \"warmup\": " << benchmarkWarmup << ",\n";
+        report << "  \"repetitions\": " << benchmarkRepetitions << ",\n";
+        report << "  \"results\": [\n";
+        for (size_t i = 0; i < results.size(); ++i) {
+            const BenchmarkResult& result = results[i];
+            report << "    {\"operation\": " << jsonString(result.operation) << ", \"implementation\": " << jsonString(result.implementation) << ", \"minNs\": " << result.minNs << ", \"medianNs\": " << result.medianNs
+                   << ", \"p95Ns\": " << result.p95Ns << ", \"meanNs\": " << result.meanNs << ", \"stddevNs\": " << result.stddevNs;
+            if (result.counted) {
+                auto counterFields = [&report](const CounterValues& counters) {
+                    report << "\"cycles\": " << counters.cycles << ", \"instructions\": " << counters.instructions << ", \"llcMisses\": " << counters.llcMisses << ", \"dtlbMisses\": " << counters.dtlbMisses
+                           << ", \"branchMisses\": " << counters.branchMisses << ", \"busyNs\": " << counters.busyNs;
+                };
+                report << ", \"counters\": {\"countedNs\": " << result.countedNs << ", ";
+                counterFields(result.counters);
+                report << ", \"threads\": [";
+                for (size_t thread = 0; thread < result.threadCounters.size(); ++thread) {
+                    report << (thread ? ", {" : "{");
+                    counterFields(result.threadCounters[thread]);
+                    report << "}";
+                }
+                report << "]}";
+            }
+            report << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        report << "  ]\n}\n";
+    }
+    return static_cast<bool>(report);
+}
+
+// Helper function for timing the multithreaded implementations at 1, 2, 4, ... sweepThreads threads and writing the report to sweepOutput (false if nothing could be run)
+bool sweepHelper(const std::vector<std::string>& names) {
+    Image image = readBmpMapped(InputFilename, false);
+    if (image.empty()) {
+        return false;
+    }
+    std::vector<unsigned int> threadCounts;
+    for (unsigned int threads = 1; threads < sweepThreads; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    threadCounts.push_back(sweepThreads);
+    int repetitions = benchmarkRepetitions > 0 ? benchmarkRepetitions : 5;
+
+    // Only the implementations that use the pool scale (parsing is left out, its file does not grow for the weak series)
+    auto multithreadedCases = [&names](const Image& input) {
+        std::vector<BenchmarkCase> cases = benchmarkCases(input, names);
+        cases.erase(std::remove_if(cases.begin(), cases.end(), [](const BenchmarkCase& benchmarkCase) {
+            return benchmarkCase.operation == "parse" || (benchmarkCase.implementation != "multipleThreads" && benchmarkCase.implementation != "fused");
+        }), cases.end());
+        return cases;
+    };
+    if (multithreadedCases(image).empty()) {
+        return false;
+    }
+
+    ThreadPool& pool = ThreadPool::instance();
+    unsigned int originalThreads = pool.size();
+    std::vector<SweepPoint> points;
+    auto record = [&](const std::string& series, unsigned int threads, int64_t pixels, const BenchmarkResult& timing) {
+        // The first point of an operation in a series is its one thread baseline
+        auto baseline = std::find_if(points.begin(), points.end(), [&](const SweepPoint& point) { return point.series == series && point.timing.operation == timing.operation; });
+        double speedup = 1.0;
+        if (baseline != points.end()) {
+            speedup = static_cast<double>(baseline->timing.medianNs) / std::max<int64_t>(timing.medianNs, 1) * (static_cast<double>(pixels) / baseline->pixels);
+        }
+        points.push_back({series, threads, pixels, timing, speedup, speedup / threads});
+        std::cout << std::fixed << std::setprecision(3) << timing.operation << " " << series << " scaling with " << threads << " threads (" << pixels << "px): median " << timing.medianNs / 1e6 << " ms, speedup "
+                  << std::setprecision(2) << speedup << "x, efficiency " << std::setprecision(0) << speedup / threads * 100 << "%" << std::endl;
+    };
+
+    std::cout << "Sweeping 1 to " << sweepThreads << " threads on " << cpuModel() << " (" << image.width() << "x" << image.height() << ", " << benchmarkWarmup << " warmup and " << repetitions << " timed runs each)..." << std::endl;
+
+    // Strong scaling: the same image on more threads
+    for (unsigned int threads : threadCounts) {
+        pool.resize(threads);
+        for (const auto& benchmarkCase : multithreadedCases(image)) {
+            record("strong", threads, static_cast<int64_t>(image.width()) * image.height(), runBenchmark(benchmarkCase, benchmarkWarmup, repetitions));
+        }
+    }
+
+    // Weak scaling: the input (and the resize outputs) grow with the thread count, so the work per thread stays the same
+    std::vector<int*> resizeHeights = {&resizeHeightBilinear, &resizeHeightBicubic, &resizeHeightNearestNeighbor, &resizeHeightLanczos};
+    std::vector<int> originalHeights;
+    for (int* height : resizeHeights) originalHeights.push_back(*height);
+    for (unsigned int threads : threadCounts) {
+        pool.resize(threads);
+        Image grown = tileImageRows(image, static_cast<int>(threads));
+        for (size_t i = 0; i < resizeHeights.size(); ++i) *resizeHeights[i] = originalHeights[i] * static_cast<int>(threads);
+        for (const auto& benchmarkCase : multithreadedCases(grown)) {
+            record("weak", threads, static_cast<int64_t>(grown.width()) * grown.height(), runBenchmark(benchmarkCase, benchmarkWarmup, repetitions));
+        }
+    }
+    for (size_t i = 0; i < resizeHeights.size(); ++i) *resizeHeights[i] = originalHeights[i];
+    pool.resize(originalThreads);
+
+    if (!writeSweepReport(sweepOutput, image, points)) {
+        std::cerr << "Could not write sweep report to: " << sweepOutput << std::endl;
+        return false;
+    }
+    std::cout << "Saved sweep report to \"" << sweepOutput << "\"" << std::endl << std::endl;
+    return true;
+}
+
+// Stack copies of an image on top of each other (a synthetic input with copies times the work)
+Image tileImageRows(const Image& image, int copies) {
+    Image tiled(image.width(), image.height() * copies);
+    ThreadPool::instance().parallelFor(tiled.height(), [&](int startRow, int endRow) {
+        for (int y = startRow; y < endRow; ++y) {
+            std::memcpy(tiled.row(y), image.row(y % image.height()), tiled.rowBytes());
+        }
+    });
+    return tiled;
+}
+
+// Write scaling sweep results with the machine and input they were measured on as JSON or CSV (by the file extension)
+bool writeSweepReport(const std::string& filename, const Image& image, const std::vector<SweepPoint>& points) {
+    std::ofstream report(filename);
+    if (!report) {
+        return false;
+    }
+    std::string cpu = cpuModel();
+    bool csv = filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".csv") == 0;
+    report << std::fixed;
+
+    if (csv) {
+        report << "cpu,hardwareThreads,input,width,height,operation,implementation,series,threads,pixels,minNs,medianNs,p95Ns,stddevNs,speedup,efficiency\n";
+        for (const auto& point : points) {
+            report << std::setprecision(1) << csvField(cpu) << "," << std::thread::hardware_concurrency() << "," << csvField(InputFilename) << "," << image.width() << "," << image.height() << ","
+                   << csvField(point.timing.operation) << "," << point.timing.implementation << "," << point.series << "," << point.threads << "," << point.pixels << ","
+                   << point.timing.minNs << "," << point.timing.medianNs << "," << point.timing.p95Ns << "," << point.timing.stddevNs << "," << std::setprecision(4) << point.speedup << "," << point.efficiency << "\n";
+        }
+    } else {
+        report << "{\n";
+        report << "  \"cpu\": " << jsonString(cpu) << ",\n";
+        report << "  \"hardwareThreads\": " << std::thread::hardware_concurrency() << ",\n";
+        report << "  \"input\": " << jsonString(InputFilename) << ",\n";
+        report << "  \"width\": " << image.width() << ",\n";
+        report << "  \"height\": " << image.height() << ",\n";
+        report << "  \"points\": [\n";
+        for (size_t i = 0; i < points.size(); ++i) {
+            const SweepPoint& point = points[i];
+            report << std::setprecision(1) << "    {\"operation\": " << jsonString(point.timing.operation) << ", \"implementation\": " << jsonString(point.timing.implementation) << ", \"series\": " << jsonString(point.series)
+                   << ", \"threads\": " << point.threads << ", \"pixels\": " << point.pixels << ", \"minNs\": " << point.timing.minNs << ", \"medianNs\": " << point.timing.medianNs << ", \"p95Ns\": " << point.timing.p95Ns
+                   << ", \"stddevNs\": " << point.timing.stddevNs << std::setprecision(4) << ", \"speedup\": " << point.speedup << ", \"efficiency\": " << point.efficiency << "}" << (i + 1 < points.size() ? "," : "") << "\n";
+        }
+        report << "  ]\n}\n";
+    }
+    return static_cast<bool>(report);
+}
+
+// Name of the CPU ("unknown" where it cannot be read)
+std::string cpuModel() {
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    for (std::string line; std::getline(cpuinfo, line);) {
+        if (line.rfind("model name", 0) == 0 && line.find(':') != std::string::npos) {
+            return line.substr(line.find_first_not_of(" \t", line.find(':') + 1));
+        }
+    }
+    return "unknown";
+}
+
+// Quote a string for JSON
+std::string jsonString(const std::string& text) {
+    std::string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+            quoted += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            quoted += escaped;
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "\"";
+}
+
+// Quote a string for CSV (embedded quotes doubled, nothing else escaped)
+std::string csvField(const std::string& text) {
+    std::string quoted = "\"";
+    for (char c : text) quoted += c == '"' ? std::string("\"\"") : std::string(1, c);
+    return quoted + "\"";
+}
+
+// Helper function for running jobs (each a function or pipeline) once with their fastest implementation, all at the same time (false if one of them is unknown)
+bool productionHelper(const Image& image, const std::vector<std::vector<std::string>>& jobs) {
+    struct JobResult {
+        std::string label, outputFilename;
+        long long milliseconds = 0;
+        bool planned = false;
+    };
+    std::vector<JobResult> results(jobs.size());
+
+    // Every job gets a thread of its own on the shared read-only image (the operations' parallelFor calls run inline), a single job gets the whole pool
+    auto start = std::chrono::high_resolution_clock::now();
+    ThreadPool::instance().parallelForTiles(1, static_cast<int>(jobs.size()), 1, 1, [&](int, int startJob, int, int endJob) {
+        for (int i = startJob; i < endJob; ++i) {
+            auto jobStart = std::chrono::high_resolution_clock::now();
+            std::vector<PipelineStage> stages;
+            if (!planPipeline(jobs[i], image.width(), image.height(), stages)) {
+                continue;
+            }
+            for (const auto& stage : stages) {
+                results[i].label += (results[i].label.empty() ? "" : " -> ") + stage.label;
+            }
+            results[i].outputFilename = stages.size() == 1 ? stages[0].outputFilename : PipelineOutputFilename;
+            Image output = runPipelineFused(image, stages);
+            writeBmpMultipleThreads(results[i].outputFilename, output, true, output.width(), output.height());
+            results[i].milliseconds = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - jobStart).count();
+            results[i].planned = true;
+        }
+    });
+    auto end = std::chrono::high_resolution_clock::now();
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+
+    bool succeeded = true;
+    for (const auto& result : results) {
+        if (!result.planned) {
+            succeeded = false;
+            continue;
+        }
+        std::cout << "Time taken for applying " << result.label << " and saving it to \"" << result.outputFilename << "\": " << result.milliseconds << " milliseconds." << std::endl;
+    }
+    std::cout << "Time taken for all " << jobs.size() << (jobs.size() == 1 ? " job: " : " jobs: ") << elapsed.count() << " milliseconds." << std::endl << std::endl;
+    return succeeded;
+}
+
+// Helper function for serving requests on serverSocket until one asks it to quit (false if the socket could not be set up)
+// Requests are single lines of space separated name=value pairs: any parameter, input=<path> (or inputImageSize), output=<path> or shm=<name> for the result
+// Parameters stay set for later requests (a client only sends what changed), and a line of just "quit" stops the server
+bool serverHelper() {
+#ifdef _WIN32
+    std::cerr << "Server mode needs Unix domain sockets, which this build does not have." << std::endl;
+    return false;
+#else
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (serverSocket.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Server socket path is too long: " << serverSocket << std::endl;
+        return false;
+    }
+    std::strncpy(address.sun_path, serverSocket.c_str(), sizeof(address.sun_path) - 1);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(serverSocket.c_str()); // A socket left behind by an earlier server
+    if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, 16) != 0) {
+        perror("Could not listen on the server socket");
+        if (listener >= 0) close(listener);
+        return false;
+    }
+    ThreadPool::instance(); // Start the worker threads now rather than on the first request
+    std::cout << "Serving requests on \"" << serverSocket << "\" with " << ThreadPool::instance().size() << " threads..." << std::endl;
+
+    // One connection at a time (the pool already spreads each request over every thread), each sending any number of request lines
+    std::unordered_map<std::string, ServerImage> images;
+    uint64_t requestNumber = 0;
+    bool quit = false;
+    while (!quit) {
+        int connection = accept(listener, nullptr, nullptr);
+        if (connection < 0) {
+            if (errno == EINTR) continue;
+            perror("Could not accept a server connection");
+            break;
+        }
+
+        std::string pending;
+        char buffer[4096];
+        for (ssize_t received; !quit && (received = recv(connection, buffer, sizeof(buffer), 0)) > 0;) {
+            pending.append(buffer, received);
+            for (size_t newline; !quit && (newline = pending.find('\n')) != std::string::npos;) {
+                std::string request = pending.substr(0, newline);
+                pending.erase(0, newline + 1);
+                std::string response = handleServerRequest(request, images, ++requestNumber, quit) + "\n";
+                std::cout << request << " -> " << response << std::flush;
+                send(connection, response.data(), response.size(), MSG_NOSIGNAL); // A client that hung up just misses its answer
+            }
+        }
+        close(connection);
+    }
+
+    close(listener);
+    unlink(serverSocket.c_str());
+    std::cout << "Server stopped." << std::endl << std::endl;
+    return true;
+#endif
+}
+
+// Run one server request line and return its one line response
+std::string handleServerRequest(const std::string& request, std::unordered_map<std::string, ServerImage>& images, uint64_t requestNumber, bool& quit) {
+    std::string input, output, sharedMemory;
+    size_t first = request.find_first_not_of(" \t\r");
+    if (first == std::string::npos) {
+        return "error empty request";
+    }
+    std::string trimmed = request.substr(first, request.find_last_not_of(" \t\r") + 1 - first);
+    if (trimmed == "quit") {
+        quit = true;
+        return "ok quit";
+    }
+    if (trimmed == "ping") {
+        return "ok ping";
+    }
+
+    // Every pair is checked before any is applied, and a request that fails puts the parameters back, so a bad line changes nothing
+    std::vector<std::pair<std::string, std::string>> parameters;
+    for (size_t position = 0; position < trimmed.size();) {
+        size_t end = std::min(trimmed.find(' ', position), trimmed.size());
+        std::string pair = trimmed.substr(position, end - position);
+        position = end + 1;
+        if (pair.empty()) continue;
+        size_t equals = pair.find('=');
+        std::string name = pair.substr(0, equals), value = equals == std::string::npos ? "" : pair.substr(equals + 1);
+        if (name == "input") {
+            input = value;
+        } else if (name == "output") {
+            output = value;
+        } else if (name == "shm") {
+            sharedMemory = value;
+        } else if (equals == std::string::npos || std::none_of(std::begin(ServerParameters), std::end(ServerParameters), [&name](const char* allowed) { return name == allowed; })) {
+            return "error unknown parameter " + pair;
+        } else {
+            parameters.emplace_back(name, value);
+        }
+    }
+    auto state = [] {
+        return std::tie(sigma, boxSize, motionLength, motionAngle, bucketFillThreshold, bucketFillX, bucketFillY, resizeWidthBilinear, resizeHeightBilinear, resizeWidthBicubic, resizeHeightBicubic,
+            resizeWidthNearestNeighbor, resizeHeightNearestNeighbor, resizeWidthLanczos, resizeHeightLanczos, inputImageSize, function, separableGaussianBlur, fixedPoint, useSimd, tileSize);
+    };
+    auto saved = std::apply([](const auto&... values) { return std::make_tuple(values...); }, state());
+    auto fail = [&](const std::string& reason) {
+        state() = saved;
+        return "error " + reason;
+    };
+    for (const auto& [name, value] : parameters) {
+        setParameter(name, value);
+    }
+    if (input.empty() && !inputFilenameFor(inputImageSize, input)) {
+        return fail("unknown input image size " + inputImageSize);
+    }
+
+    // The operations and their parameters are checked up front, so nothing reaches an operation that would fail or crash on them
+    std::vector<std::string> names;
+    for (size_t begin = 0, comma; begin <= function.size(); begin = comma + 1) {
+        comma = std::min(function.find(',', begin), function.size());
+        names.push_back(function.substr(begin, comma - begin));
+    }
+    for (const auto& name : names) {
+        if (std::none_of(std::begin(FunctionNames), std::end(FunctionNames), [&name](const char* known) { return name == known; })) {
+            return fail("unknown function " + name);
+        }
+        auto [width, height] = name == "bilinearResize" ? std::make_pair(resizeWidthBilinear, resizeHeightBilinear)
+            : name == "bicubicResize" ? std::make_pair(resizeWidthBicubic, resizeHeightBicubic)
+            : name == "nearestNeighborResize" ? std::make_pair(resizeWidthNearestNeighbor, resizeHeightNearestNeighbor)
+            : name == "lanczosResize" ? std::make_pair(resizeWidthLanczos, resizeHeightLanczos) : std::make_pair(1, 1);
+        if (width <= 0 || height <= 0) return fail("resize size must be positive for " + name);
+        if (name == "gaussianBlur" && !(sigma > 0)) return fail("sigma must be positive");
+        if (name == "boxBlur" && boxSize < 1) return fail("boxSize must be at least 1");
+        if (name == "motionBlur" && motionLength < 1) return fail("motionLength must be at least 1");
+    }
+
+    // Decoded inputs stay resident until their file changes
     auto start = std::chrono::high_resolution_clock::now();
-    auto image = readBmpSingleThread(InputFilename);
-    auto end = std::chrono::high_resolution_clock::now();
-    auto elapsedSingle = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-    std::cout << "Time taken for parsing input image using a single thread (" << (image[0].size() * image.size()) << "px): " << elapsedSingle.count() << " milliseconds." << std::endl;
+    std::error_code error;
+    auto modified = std::filesystem::last_write_time(input, error);
+    uintmax_t size = error ? 0 : std::filesystem::file_size(input, error);
+    if (error) {
+        return fail("cannot read " + input);
+    }
+    auto cached = images.find(input);
+    bool hit = cached != images.end() && cached->second.modified == modified && cached->second.size == size;
+    if (!hit) {
+        Image image = readBmpMapped(input, false);
+        if (image.empty()) {
+            return fail("cannot decode " + input);
+        }
+        if (cached == images.end() && images.size() >= MaxServerImages) {
+            images.erase(std::min_element(images.begin(), images.end(), [](const auto& a, const auto& b) { return a.second.lastUsed < b.second.lastUsed; }));
+        }
+        images[input] = {std::move(image), modified, size, 0};
+        cached = images.find(input);
+    }
+    cached->second.lastUsed = requestNumber;
 
-    std::cout << "Parsing input image using multiple threads..." << std::endl;
-    start = std::chrono::high_resolution_clock::now();
-    image = readBmpMultipleThreads(InputFilename);
-    end = std::chrono::high_resolution_clock::now();
-    auto elapsedMultiple = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
-    std::cout << "Time taken for parsing input image using multiple threads (" << (image[0].size() * image.size()) << "px): " << elapsedMultiple.count() << " milliseconds." << std::endl;
+    const Image& image = cached->second.image;
+    std::vector<PipelineStage> stages;
+    if (!planPipeline(names, image.width(), image.height(), stages)) {
+        return fail("cannot plan " + function);
+    }
+    for (const auto& stage : stages) {
+        // The seed has to lie in the image the fill gets, which an earlier resize may have changed
+        if (stage.name == "bucketFill" && (bucketFillX < 0 || bucketFillX >= stage.inputWidth || bucketFillY < 0 || bucketFillY >= stage.inputHeight)) {
+            return fail("seed outside image");
+        }
+    }
+    Image result = runPipelineFused(image, stages);
+
+    // The result goes to a file (the function's usual output by default) or a shared memory object holding the same BMP bytes
+    std::string location;
+    if (!sharedMemory.empty()) {
+        uint64_t bytes = 0;
+        if (!writeBmpToSharedMemory(sharedMemory, result, bytes)) {
+            return fail("cannot write shared memory " + sharedMemory);
+        }
+        location = "shm:" + sharedMemory + " " + std::to_string(bytes);
+    } else {
+        location = !output.empty() ? output : stages.size() == 1 ? stages[0].outputFilename : PipelineOutputFilename;
+        writeBmpMultipleThreads(location, result, true, result.width(), result.height());
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    double milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
 
-    double speedupFactor = static_cast<double>(elapsedSingle.count()) / elapsedMultiple.count();
+    std::ostringstream response;
+    response << "ok " << location << " " << result.width() << "x" << result.height() << " " << std::fixed << std::setprecision(2) << milliseconds << "ms" << (hit ? " cached" : "");
+    return response.str();
+}
 
-    std::cout << "Multithreading speedup factor: " << std::fixed << std::setprecision(1) << speedupFactor << "x" << std::endl << std::endl;
+// Encode an image as a BMP file into a POSIX shared memory object (false if it could not be created)
+bool writeBmpToSharedMemory(const std::string& name, const Image& image, uint64_t& bytes) {
+#ifdef _WIN32
+    return false;
+#else
+    size_t rowSize = (image.rowBytes() + 3) & ~static_cast<size_t>(3);
+    bytes = 54 + static_cast<uint64_t>(rowSize) * image.height();
+    std::string objectName = name[0] == '/' ? name : "/" + name;
+    int fd = shm_open(objectName.c_str(), O_CREAT | O_RDWR, 0600);
+    if (fd < 0) {
+        return false;
+    }
+    void* mapping = ftruncate(fd, static_cast<off_t>(bytes)) == 0 ? mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
 
-    return image;
+    uint8_t* destination = static_cast<uint8_t*>(mapping);
+    fillBmpHeader(destination, image.width(), image.height());
+    ThreadPool::instance().parallelFor(image.height(), [&](int startRow, int endRow) {
+        for (int y = startRow; y < endRow; ++y) {
+            uint8_t* row = destination + 54 + rowSize * y;
+            std::memcpy(row, image.row(y), image.rowBytes());
+            std::memset(row + image.rowBytes(), 0, rowSize - image.rowBytes());
+        }
+    });
+    munmap(mapping, bytes);
+    return true;
+#endif
 }
 
 // Helper function for timing and implementing the gaussian blur function
-void gaussianBlurHelper(std::vector<std::vector<RGB>> image) {
-    std::cout << "Applying Gaussian blur using a single thread (sigma=" << sigma << ")..." << std::endl;
+void gaussianBlurHelper(const Image& image) {
+    TraceSpan span("gaussianBlur");
+    std::cout << "Applying Gaussian blur using a single thread (sigma=" << sigma << (separableGaussianBlur ? std::string(", separable, ") + rowKernels().name : "") << ")..." << std::endl;
     auto start = std::chrono::high_resolution_clock::now();
-    auto kernel = generateGaussianKernelSingleThread(sigma);
-    auto blurredImage = applyGaussianBlurSingleThread(image, kernel);
+    Image blurredImage;
+    if (separableGaussianBlur) {
+        blurredImage = applySeparableGaussianBlurSingleThread(image, generateGaussianKernel1D(sigma));
+    } else {
+        auto kernel = generateGaussianKernelSingleThread(sigma);
+        blurredImage = applyGaussianBlurSingleThread(image, kernel);
+    }
     auto end = std::chrono::high_resolution_clock::now();
     auto elapsedSingle = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
     std::cout << "Time taken for applying Gaussian blur using a single thread: " << elapsedSingle.count() << " milliseconds." << std::endl;
     writeBmp(GaussianBlurredOutputFilename, blurredImage, false);
     std::cout << "Saved gaussian blurred image to \"" << GaussianBlurredOutputFilename << "\"" << std::endl;
 
-    std::cout << "Applying Gaussian blur using multiple threads (sigma=" << sigma << ")..." << std::endl;
+    std::cout << "Applying Gaussian blur using multiple threads (sigma=" << sigma << (separableGaussianBlur ? std::string(", separable, ") + rowKernels().name : "") << ")..." << std::endl;
     start = std::chrono::high_resolution_clock::now();
-    kernel = generateGaussianKernelMultipleThreads(sigma);
-    blurredImage = applyGaussianBlurMultipleThreads(image, kernel);
+    if (separableGaussianBlur) {
+        blurredImage = applySeparableGaussianBlurMultipleThreads(image, *gaussianKernel1DFor(sigma));
+    } else {
+        blurredImage = applyGaussianBlurMultipleThreads(image, *gaussianKernel2DFor(sigma));
+    }
     end = std::chrono::high_resolution_clock::now();
     auto elapsedMultiple = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
     std::cout << "Time taken for applying Gaussian blur using multiple threads: " << elapsedMultiple.count() << " milliseconds." << std::endl;
-    writeBmp(GaussianBlurredOutputFilename, blurredImage, false);
+    writeBmpMultipleThreads(GaussianBlurredOutputFilename, blurredImage, false);
     std::cout << "Saved gaussian blurred image to \"" << GaussianBlurredOutputFilename << "\"" << std::endl;
 
     double speedupFactor = static_cast<double>(elapsedSingle.count()) / elapsedMultiple.count();
@@ -309,8 +2821,9 @@ void gaussianBlurHelper(std::vector<std::vector<RGB>> image) {
 }
 
 // Helper function for timing and implementing the box blur function
-void boxBlurHelper(std::vector<std::vector<RGB>> image) {
-    std::cout << "Applying box blur using a single thread (boxSize=" << boxSize << ")..." << std::endl;
+void boxBlurHelper(const Image& image) {
+    TraceSpan span("boxBlur");
+    std::cout << "Applying box blur using a single thread (boxSize=" << boxSize << ", " << rowKernels().name << ")..." << std::endl;
     auto start = std::chrono::high_resolution_clock::now();
     auto boxBlurredImage = applyBoxBlurSingleThread(image, boxSize);
     auto end = std::chrono::high_resolution_clock::now();
@@ -319,13 +2832,13 @@ void boxBlurHelper(std::vector<std::vector<RGB>> image) {
     writeBmp(BoxBlurredOutputFilename, boxBlurredImage, false);
     std::cout << "Saved box-blurred image to \"" << BoxBlurredOutputFilename << "\"" << std::endl;
 
-    std::cout << "Applying box blur using multiple threads (boxSize=" << boxSize << ")..." << std::endl;
+    std::cout << "Applying box blur using multiple threads (boxSize=" << boxSize << ", " << rowKernels().name << ")..." << std::endl;
     start = std::chrono::high_resolution_clock::now();
     boxBlurredImage = applyBoxBlurMultipleThreads(image, boxSize);
     end = std::chrono::high_resolution_clock::now();
     auto elapsedMultiple = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
     std::cout << "Time taken for applying box blur using multiple threads: " << elapsedMultiple.count() << " milliseconds." << std::endl;
-    writeBmp(BoxBlurredOutputFilename, boxBlurredImage, false);
+    writeBmpMultipleThreads(BoxBlurredOutputFilename, boxBlurredImage, false);
     std::cout << "Saved box-blurred image to \"" << BoxBlurredOutputFilename << "\"" << std::endl;
 
     double speedupFactor = static_cast<double>(elapsedSingle.count()) / elapsedMultiple.count();
@@ -334,23 +2847,24 @@ void boxBlurHelper(std::vector<std::vector<RGB>> image) {
 }
 
 // Helper function for timing and implementing the motion blur function
-void motionBlurHelper(std::vector<std::vector<RGB>> image) {
-    std::cout << "Applying motion blur using a single thread (motionLength=" << motionLength << ")..." << std::endl;
+void motionBlurHelper(const Image& image) {
+    TraceSpan span("motionBlur");
+    std::cout << "Applying motion blur using a single thread (motionLength=" << motionLength << ", motionAngle=" << motionAngle << ")..." << std::endl;
     auto start = std::chrono::high_resolution_clock::now();
-    auto motionBlurredImage = applyMotionBlurSingleThread(image, motionLength);
+    auto motionBlurredImage = applyMotionBlurSingleThread(image, motionLength, motionAngle);
     auto end = std::chrono::high_resolution_clock::now();
     auto elapsedSingle = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
     std::cout << "Time taken for applying motion blur using a single thread: " << elapsedSingle.count() << " milliseconds." << std::endl;
     writeBmp(MotionBlurredOutputFilename, motionBlurredImage, false);
     std::cout << "Saved motion-blurred image to \"" << MotionBlurredOutputFilename << "\"" << std::endl;
 
-    std::cout << "Applying motion blur using multiple threads (motionLength=" << motionLength << ")..." << std::endl;
+    std::cout << "Applying motion blur using multiple threads (motionLength=" << motionLength << ", motionAngle=" << motionAngle << ")..." << std::endl;
     start = std::chrono::high_resolution_clock::now();
-    motionBlurredImage = applyMotionBlurMultipleThreads(image, motionLength);
+    motionBlurredImage = applyMotionBlurMultipleThreads(image, motionLength, motionAngle);
     end = std::chrono::high_resolution_clock::now();
     auto elapsedMultiple = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
     std::cout << "Time taken for applying motion blur using multiple threads: " << elapsedMultiple.count() << " milliseconds." << std::endl;
-    writeBmp(MotionBlurredOutputFilename, motionBlurredImage, false);
+    writeBmpMultipleThreads(MotionBlurredOutputFilename, motionBlurredImage, false);
     std::cout << "Saved motion-blurred image to \"" << MotionBlurredOutputFilename << "\"" << std::endl;
 
     double speedupFactor = static_cast<double>(elapsedSingle.count()) / elapsedMultiple.count();
@@ -359,7 +2873,8 @@ void motionBlurHelper(std::vector<std::vector<RGB>> image) {
 }
 
 // Helper function for timing and implementing the bucket fill function
-void bucketFillHelper(std::vector<std::vector<RGB>> image) {
+void bucketFillHelper(const Image& image) {
+    TraceSpan span("bucketFill");
     std::cout << "Applying bucket fill using a single thread (Threshold=" << bucketFillThreshold << ")..." << std::endl;
     auto start = std::chrono::high_resolution_clock::now();
     auto bucketFilledImage = applyBucketFillSingleThread(image, bucketFillThreshold);
@@ -375,32 +2890,51 @@ void bucketFillHelper(std::vector<std::vector<RGB>> image) {
     end = std::chrono::high_resolution_clock::now();
     auto elapsedMultiple = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
     std::cout << "Time taken for applying bucket fill using multiple threads: " << elapsedMultiple.count() << " milliseconds." << std::endl;
-    writeBmp(BucketFillOutputFilename, bucketFilledImage, false);
+    writeBmpMultipleThreads(BucketFillOutputFilename, bucketFilledImage, false);
     std::cout << "Saved bucket-filled image to \"" << BucketFillOutputFilename << "\"" << std::endl;
 
     double speedupFactor = static_cast<double>(elapsedSingle.count()) / elapsedMultiple.count();
 
     std::cout << "Multithreading speedup factor: " << std::fixed << std::setprecision(1) << speedupFactor << "x" << std::endl << std::endl;
+
+    // The first indexed fill labels the regions, repeating it (as interactive use does) only looks the seeds up
+    std::vector<std::pair<int, int>> seeds = {{bucketFillX, bucketFillY}};
+    seeds.insert(seeds.end(), bucketFillSeeds.begin(), bucketFillSeeds.end());
+    std::cout << "Applying bucket fill from the region index (Threshold=" << bucketFillThreshold << ", " << seeds.size() << " seeds)..." << std::endl;
+    start = std::chrono::high_resolution_clock::now();
+    bucketFilledImage = applyBucketFillIndexed(image, bucketFillThreshold, seeds);
+    end = std::chrono::high_resolution_clock::now();
+    auto elapsedIndexBuild = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    start = std::chrono::high_resolution_clock::now();
+    bucketFilledImage = applyBucketFillIndexed(image, bucketFillThreshold, seeds);
+    end = std::chrono::high_resolution_clock::now();
+    auto elapsedIndexQuery = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    std::cout << "Time taken for applying bucket fill from the region index: " << elapsedIndexBuild.count() << " milliseconds (" << elapsedIndexQuery.count() << " milliseconds once cached)." << std::endl;
+    writeBmpMultipleThreads(BucketFillOutputFilename, bucketFilledImage, false);
+    std::cout << "Saved bucket-filled image to \"" << BucketFillOutputFilename << "\"" << std::endl << std::endl;
 }
 
 // Helper function for timing and implementing the bilinear resize function
-void bilinearResizeHelper(std::vector<std::vector<RGB>> image) {
-    std::cout << "Applying bilinear resizing using a single thread (Output Size=" << resizeWidthBilinear << "x" << resizeHeightBilinear << ")..." << std::endl;
+void bilinearResizeHelper(const Image& image) {
+    TraceSpan span("bilinearResize");
+    std::cout << "Applying bilinear resizing using a single thread (Output Size=" << resizeWidthBilinear << "x" << resizeHeightBilinear << (separableResize ? ", separable" : "") << ")..." << std::endl;
     auto start = std::chrono::high_resolution_clock::now();
-    auto bilinearResizedImage = resizeBilinearSingleThread(image, resizeWidthBilinear, resizeHeightBilinear);
+    auto bilinearResizedImage = separableResize ? resizeSeparableSingleThread(image, *resizePlanFor(ResizeFilter::Bilinear, image.width(), image.height(), resizeWidthBilinear, resizeHeightBilinear))
+                                                : resizeBilinearSingleThread(image, resizeWidthBilinear, resizeHeightBilinear);
     auto end = std::chrono::high_resolution_clock::now();
     auto elapsedSingle = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
     std::cout << "Time taken for applying bilinear resizing using a single thread: " << elapsedSingle.count() << " milliseconds." << std::endl;
     writeBmp(BilinearResizedOutputFilename, bilinearResizedImage, true, resizeWidthBilinear, resizeHeightBilinear);
     std::cout << "Saved bilinear-resized image to \"" << BilinearResizedOutputFilename << "\"" << std::endl;
 
-    std::cout << "Applying bilinear resizing using multiple threads (Output Size=" << resizeWidthBilinear << "x" << resizeHeightBilinear << ")..." << std::endl;
+    std::cout << "Applying bilinear resizing using multiple threads (Output Size=" << resizeWidthBilinear << "x" << resizeHeightBilinear << (separableResize ? ", separable" : "") << ")..." << std::endl;
     start = std::chrono::high_resolution_clock::now();
-    bilinearResizedImage = resizeBilinearMultipleThreads(image, resizeWidthBilinear, resizeHeightBilinear);
+    bilinearResizedImage = separableResize ? resizeSeparableMultipleThreads(image, *resizePlanFor(ResizeFilter::Bilinear, image.width(), image.height(), resizeWidthBilinear, resizeHeightBilinear))
+                                           : resizeBilinearMultipleThreads(image, resizeWidthBilinear, resizeHeightBilinear);
     end = std::chrono::high_resolution_clock::now();
     auto elapsedMultiple = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
     std::cout << "Time taken for applying bilinear resizing using multiple threads: " << elapsedMultiple.count() << " milliseconds." << std::endl;
-    writeBmp(BilinearResizedOutputFilename, bilinearResizedImage, true, resizeWidthBilinear, resizeHeightBilinear);
+    writeBmpMultipleThreads(BilinearResizedOutputFilename, bilinearResizedImage, true, resizeWidthBilinear, resizeHeightBilinear);
     std::cout << "Saved bilinear-resized image to \"" << BilinearResizedOutputFilename << "\"" << std::endl;
 
     double speedupFactor = static_cast<double>(elapsedSingle.count()) / elapsedMultiple.count();
@@ -409,23 +2943,26 @@ void bilinearResizeHelper(std::vector<std::vector<RGB>> image) {
 }
 
 // Helper function for timing and implementing the bicubic resize function
-void bicubicResizeHelper(std::vector<std::vector<RGB>> image) {
-    std::cout << "Applying bicubic resizing using a single thread (Output Size=" << resizeWidthBicubic << "x" << resizeHeightBicubic << ")..." << std::endl;
+void bicubicResizeHelper(const Image& image) {
+    TraceSpan span("bicubicResize");
+    std::cout << "Applying bicubic resizing using a single thread (Output Size=" << resizeWidthBicubic << "x" << resizeHeightBicubic << (separableResize ? ", separable" : "") << ")..." << std::endl;
     auto start = std::chrono::high_resolution_clock::now();
-    auto bicubicResizedImage = resizeBicubicSingleThread(image, resizeWidthBicubic, resizeHeightBicubic);
+    auto bicubicResizedImage = separableResize ? resizeSeparableSingleThread(image, *resizePlanFor(ResizeFilter::Bicubic, image.width(), image.height(), resizeWidthBicubic, resizeHeightBicubic))
+                                               : resizeBicubicSingleThread(image, resizeWidthBicubic, resizeHeightBicubic);
     auto end = std::chrono::high_resolution_clock::now();
     auto elapsedSingle = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
     std::cout << "Time taken for applying bicubic resizing using a single thread: " << elapsedSingle.count() << " milliseconds." << std::endl;
     writeBmp(BicubicResizedOutputFilename, bicubicResizedImage, true, resizeWidthBicubic, resizeHeightBicubic);
     std::cout << "Saved bicubic-resized image to \"" << BicubicResizedOutputFilename << "\"" << std::endl;
 
-    std::cout << "Applying bicubic resizing using multiple threads (Output Size=" << resizeWidthBicubic << "x" << resizeHeightBicubic << ")..." << std::endl;
+    std::cout << "Applying bicubic resizing using multiple threads (Output Size=" << resizeWidthBicubic << "x" << resizeHeightBicubic << (separableResize ? ", separable" : "") << ")..." << std::endl;
     start = std::chrono::high_resolution_clock::now();
-    bicubicResizedImage = resizeBicubicMultipleThreads(image, resizeWidthBicubic, resizeHeightBicubic);
+    bicubicResizedImage = separableResize ? resizeSeparableMultipleThreads(image, *resizePlanFor(ResizeFilter::Bicubic, image.width(), image.height(), resizeWidthBicubic, resizeHeightBicubic))
+                                          : resizeBicubicMultipleThreads(image, resizeWidthBicubic, resizeHeightBicubic);
     end = std::chrono::high_resolution_clock::now();
     auto elapsedMultiple = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
     std::cout << "Time taken for applying bicubic resizing using multiple threads: " << elapsedMultiple.count() << " milliseconds." << std::endl;
-    writeBmp(BicubicResizedOutputFilename, bicubicResizedImage, true, resizeWidthBicubic, resizeHeightBicubic);
+    writeBmpMultipleThreads(BicubicResizedOutputFilename, bicubicResizedImage, true, resizeWidthBicubic, resizeHeightBicubic);
     std::cout << "Saved bicubic-resized image to \"" << BicubicResizedOutputFilename << "\"" << std::endl;
 
     double speedupFactor = static_cast<double>(elapsedSingle.count()) / elapsedMultiple.count();
@@ -434,7 +2971,8 @@ void bicubicResizeHelper(std::vector<std::vector<RGB>> image) {
 }
 
 // Helper function for timing and implementing the nearest neighbor resize function
-void nearestNeighborResizeHelper(std::vector<std::vector<RGB>> image) {
+void nearestNeighborResizeHelper(const Image& image) {
+    TraceSpan span("nearestNeighborResize");
     std::cout << "Applying nearest neighbor resizing using a single thread (Output Size=" << resizeWidthNearestNeighbor << "x" << resizeHeightNearestNeighbor << ")..." << std::endl;
     auto start = std::chrono::high_resolution_clock::now();
     auto nearestNeighborResizedImage = nearestNeighborResizeSingleThread(image, resizeWidthNearestNeighbor, resizeHeightNearestNeighbor);
@@ -450,7 +2988,7 @@ void nearestNeighborResizeHelper(std::vector<std::vector<RGB>> image) {
     end = std::chrono::high_resolution_clock::now();
     auto elapsedMultiple = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
     std::cout << "Time taken for applying nearest neighbor resizing using multiple threads: " << elapsedMultiple.count() << " milliseconds." << std::endl;
-    writeBmp(nearestNeighborResizedOutputFilename, nearestNeighborResizedImage, true, resizeWidthNearestNeighbor, resizeHeightNearestNeighbor);
+    writeBmpMultipleThreads(nearestNeighborResizedOutputFilename, nearestNeighborResizedImage, true, resizeWidthNearestNeighbor, resizeHeightNearestNeighbor);
     std::cout << "Saved nearestNeighbor-resized image to \"" << nearestNeighborResizedOutputFilename << "\"" << std::endl;
 
     double speedupFactor = static_cast<double>(elapsedSingle.count()) / elapsedMultiple.count();
@@ -458,10 +2996,43 @@ void nearestNeighborResizeHelper(std::vector<std::vector<RGB>> image) {
     std::cout << "Multithreading speedup factor: " << std::fixed << std::setprecision(1) << speedupFactor << "x" << std::endl << std::endl;
 }
 
+// Helper function for timing and implementing the Lanczos-3 resize function
+void lanczosResizeHelper(const Image& image) {
+    TraceSpan span("lanczosResize");
+    if (resizeWidthLanczos <= 0 || resizeHeightLanczos <= 0) {
+        std::cerr << "Resize target must be at least 1x1 for lanczosResize, not " << resizeWidthLanczos << "x" << resizeHeightLanczos << std::endl;
+        return;
+    }
+    auto plan = resizePlanFor(ResizeFilter::Lanczos3, image.width(), image.height(), resizeWidthLanczos, resizeHeightLanczos);
+
+    std::cout << "Applying Lanczos-3 resizing using a single thread (Output Size=" << resizeWidthLanczos << "x" << resizeHeightLanczos << ")..." << std::endl;
+    auto start = std::chrono::high_resolution_clock::now();
+    auto lanczosResizedImage = resizeSeparableSingleThread(image, *plan);
+    auto end = std::chrono::high_resolution_clock::now();
+    auto elapsedSingle = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    std::cout << "Time taken for applying Lanczos-3 resizing using a single thread: " << elapsedSingle.count() << " milliseconds." << std::endl;
+    writeBmp(LanczosResizedOutputFilename, lanczosResizedImage, true, resizeWidthLanczos, resizeHeightLanczos);
+    std::cout << "Saved lanczos-resized image to \"" << LanczosResizedOutputFilename << "\"" << std::endl;
+
+    std::cout << "Applying Lanczos-3 resizing using multiple threads (Output Size=" << resizeWidthLanczos << "x" << resizeHeightLanczos << ")..." << std::endl;
+    start = std::chrono::high_resolution_clock::now();
+    lanczosResizedImage = resizeSeparableMultipleThreads(image, *plan);
+    end = std::chrono::high_resolution_clock::now();
+    auto elapsedMultiple = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    std::cout << "Time taken for applying Lanczos-3 resizing using multiple threads: " << elapsedMultiple.count() << " milliseconds." << std::endl;
+    writeBmpMultipleThreads(LanczosResizedOutputFilename, lanczosResizedImage, true, resizeWidthLanczos, resizeHeightLanczos);
+    std::cout << "Saved lanczos-resized image to \"" << LanczosResizedOutputFilename << "\"" << std::endl;
+
+    double speedupFactor = static_cast<double>(elapsedSingle.count()) / elapsedMultiple.count();
+
+    std::cout << "Multithreading speedup factor: " << std::fixed << std::setprecision(1) << speedupFactor << "x" << std::endl << std::endl;
+}
+
 // Read bitmap images with one thread
-std::vector<std::vector<RGB>> readBmpSingleThread(const std::string& filename) {
+Image readBmpSingleThread(const std::string& filename) {
+    TraceSpan span("parse (single thread)");
     std::ifstream bmpFile(filename, std::ios::binary); // Open the BMP file in binary mode
-    std::vector<std::vector<RGB>> image; // Create a 2D vector to store the pixels
+    Image image; // Create an image to store the pixels
     if (!bmpFile) {
         std::cerr << "Could not open BMP file!" << std::endl << std::endl; // Check if the file was successfully opened
         return image;
@@ -472,11 +3043,11 @@ std::vector<std::vector<RGB>> readBmpSingleThread(const std::string& filename) {
     bmpFile.read(reinterpret_cast<char*>(&width), sizeof(width)); // Read the width
     bmpFile.read(reinterpret_cast<char*>(&height), sizeof(height)); // Read the height
 
-    image.resize(height, std::vector<RGB>(width)); // Resize the vector to fit the image dimensions
+    image = Image(width, height); // Allocate one contiguous buffer that fits the image dimensions
     int rowPadding = (4 - (width * 3) % 4) % 4; // Calculate the row padding
     bmpFile.seekg(54); // Seek to the start of the image data
-    for (int y = height - 1; y >= 0; y--) {
-        bmpFile.read(reinterpret_cast<char*>(image[y].data()), width * sizeof(RGB)); // Read each row of the image
+    for (int y = 0; y < height; y++) {
+        bmpFile.read(reinterpret_cast<char*>(image.row(y)), image.rowBytes()); // Read each row of the image (row 0 is the first row in the file, like the other readers and writeBmp)
         bmpFile.ignore(rowPadding); // Ignore the row padding
     }
 
@@ -485,6 +3056,7 @@ std::vector<std::vector<RGB>> readBmpSingleThread(const std::string& filename) {
 
 // Generate the Gaussian kernel with one thread
 std::vector<std::vector<double>> generateGaussianKernelSingleThread(double sigma) {
+    TraceSpan span("gaussian kernel");
     int kernelSize = static_cast<int>(std::round(6 * sigma)) | 1; // Calculate the kernel size (guarantee odd for central pixel)
     std::vector<std::vector<double>> kernel(kernelSize, std::vector<double>(kernelSize)); // Create a 2D vector for the kernel
     double sum = 0.0; // Store the sum of all elements in the kernel
@@ -509,9 +3081,9 @@ std::vector<std::vector<double>> generateGaussianKernelSingleThread(double sigma
 }
 
 // Apply Gaussian blur to an image with one thread
-std::vector<std::vector<RGB>> applyGaussianBlurSingleThread(const std::vector<std::vector<RGB>>& image, const std::vector<std::vector<double>>& kernel) {
-    int height = image.size(), width = image[0].size(), kernelSize = kernel.size(); // Get the dimensions of the image and the kernel
-    std::vector<std::vector<RGB>> blurredImage(height, std::vector<RGB>(width)); // Create a 2D vector for the blurred image
+Image applyGaussianBlurSingleThread(const Image& image, const std::vector<std::vector<double>>& kernel) {
+    int height = image.height(), width = image.width(), kernelSize = kernel.size(); // Get the dimensions of the image and the kernel
+    Image blurredImage(width, height); // Create an image for the blurred result
 
     for (int y = 0; y < height; ++y) {
         for (int x = 0; x < width; ++x) {
@@ -538,76 +3110,215 @@ std::vector<std::vector<RGB>> applyGaussianBlurSingleThread(const std::vector<st
     return blurredImage; // Return the blurred image
 }
 
-// Apply box blur to the image with one thread
-std::vector<std::vector<RGB>> applyBoxBlurSingleThread(const std::vector<std::vector<RGB>>& image, int boxSize) {
-    int height = image.size(), width = image[0].size(); // Dimensions of the input image
-    std::vector<std::vector<RGB>> blurredImage(height, std::vector<RGB>(width)); // Preparing the output image with the same dimensions
-    int halfBoxSize = boxSize / 2; // Computing half the box size to use as an offset around each pixel
+// Generate the 1D Gaussian kernel used by the separable blur (the 2D kernel is its outer product with itself)
+std::vector<double> generateGaussianKernel1D(double sigma) {
+    TraceSpan span("gaussian kernel");
+    int kernelSize = static_cast<int>(std::round(6 * sigma)) | 1; // Same size as the 2D kernel (guarantee odd for central pixel)
+    std::vector<double> kernel(kernelSize);
+    double sum = 0.0; // Store the sum of all elements in the kernel
+    int halfSize = kernelSize / 2;
 
-    // Iterate through each pixel in the image
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            int count = 0; // Counter for the number of pixels considered in the box
-            double totalRed = 0, totalGreen = 0, totalBlue = 0; // Accumulators for the color channels
-
-            // Iterate over the box surrounding the current pixel
-            for (int dy = -halfBoxSize; dy <= halfBoxSize; ++dy) {
-                for (int dx = -halfBoxSize; dx <= halfBoxSize; ++dx) {
-                    int newY = y + dy, newX = x + dx; // Calculate the position of the neighboring pixel
-
-                    // Check if the neighboring pixel is within the image bounds
-                    if (newX >= 0 && newX < width && newY >= 0 && newY < height) {
-                        const auto& pixel = image[newY][newX]; // Access the neighboring pixel
-                        totalRed += pixel.red; // Accumulate the red color channel
-                        totalGreen += pixel.green; // Accumulate the green color channel
-                        totalBlue += pixel.blue; // Accumulate the blue color channel
-                        ++count; // Increment the counter
-                    }
-                }
-            }
+    for (int x = -halfSize; x <= halfSize; x++) {
+        kernel[x + halfSize] = std::exp(-(x * x) / (2 * sigma * sigma)); // The constant factor cancels out during normalization
+        sum += kernel[x + halfSize];
+    }
 
-            // Calculate the average for each color channel and clamp the values to the valid range [0, 255]
-            blurredImage[y][x].red = std::clamp(static_cast<int>(totalRed / count), 0, 255);
-            blurredImage[y][x].green = std::clamp(static_cast<int>(totalGreen / count), 0, 255);
-            blurredImage[y][x].blue = std::clamp(static_cast<int>(totalBlue / count), 0, 255);
+    // Normalize the kernel so its outer product matches the normalized 2D kernel
+    for (double& value : kernel) {
+        value /= sum;
+    }
+
+    return kernel;
+}
+
+// Find the baked kernels of a sigma (nullptr when it was not baked)
+const BakedGaussianKernelView* bakedGaussianKernel(double sigma) {
+    for (const auto& baked : BakedGaussianKernels) {
+        if (baked.sigma == sigma) return &baked;
+    }
+    return nullptr;
+}
+
+// Least recently used cache of one form of Gaussian kernel by sigma, shared by every thread (make builds a missing kernel)
+template <typename Kernel>
+std::shared_ptr<const Kernel> cachedGaussianKernel(double sigma, const std::function<Kernel()>& make) {
+    static std::mutex cacheMutex;
+    static std::vector<std::pair<double, std::shared_ptr<const Kernel>>> cache; // Least recently used first
+    std::lock_guard<std::mutex> lock(cacheMutex);
+
+    for (auto entry = cache.begin(); entry != cache.end(); ++entry) {
+        if (entry->first == sigma) {
+            auto hit = *entry;
+            cache.erase(entry);
+            cache.push_back(hit);
+            return hit.second;
         }
     }
 
-    return blurredImage; // Return the blurred image
+    auto kernel = std::make_shared<const Kernel>(make());
+    if (cache.size() >= MaxCachedGaussianKernels) cache.erase(cache.begin());
+    cache.emplace_back(sigma, kernel);
+    return kernel;
 }
 
-// Apply motion blur to the image based on a given motion length with one thread
-std::vector<std::vector<RGB>> applyMotionBlurSingleThread(const std::vector<std::vector<RGB>>& image, int motionLength) {
-    int height = image.size(), width = image[0].size(); // Get the dimensions of the input image
-    std::vector<std::vector<RGB>> blurredImage(height, std::vector<RGB>(width)); // Prepare the output image with the same dimensions
-    int halfLength = motionLength / 2; // Compute half the motion length to average pixels around the target pixel
+// Look up (or generate and cache) the 1D Gaussian kernel of a sigma
+std::shared_ptr<const std::vector<double>> gaussianKernel1DFor(double sigma) {
+    return cachedGaussianKernel<std::vector<double>>(sigma, [sigma] {
+        if (const auto* baked = bakedGaussianKernel(sigma)) return std::vector<double>(baked->weights1D, baked->weights1D + baked->size);
+        return generateGaussianKernel1D(sigma);
+    });
+}
+
+// Look up (or generate and cache) the 2D Gaussian kernel of a sigma
+std::shared_ptr<const std::vector<std::vector<double>>> gaussianKernel2DFor(double sigma) {
+    return cachedGaussianKernel<std::vector<std::vector<double>>>(sigma, [sigma] {
+        const auto* baked = bakedGaussianKernel(sigma);
+        if (!baked) return generateGaussianKernelSingleThread(sigma);
+        std::vector<std::vector<double>> kernel(baked->size);
+        for (int x = 0; x < baked->size; ++x) {
+            kernel[x].assign(baked->weights2D + x * baked->size, baked->weights2D + (x + 1) * baked->size);
+        }
+        return kernel;
+    });
+}
+
+// Convolve the tile [startX, endX) x [startY, endY) of the image horizontally with the 1D kernel into a float buffer (3 floats per pixel in blue, green, red order)
+void applyGaussianHorizontalPass(const Image& image, const std::vector<double>& kernel, std::vector<float>& horizontal, int startX, int startY, int endX, int endY) {
+    int width = image.width(), kernelSize = static_cast<int>(kernel.size()), halfSize = kernelSize / 2;
+    const RowKernels& kernels = rowKernels();
+    std::vector<float> weights(kernel.begin(), kernel.end());
+
+    // The tile's span of a row widened to floats with halfSize zero pixels on either side, out of bounds taps then contribute nothing (like the 2D path)
+    int spanStart = std::max(startX - halfSize, 0), spanEnd = std::min(endX + halfSize, width);
+    std::vector<float> padded(static_cast<size_t>(endX - startX + 2 * halfSize) * 3, 0.0f);
+    float* spanDestination = padded.data() + (spanStart - (startX - halfSize)) * 3;
+
+    for (int y = startY; y < endY; ++y) {
+        kernels.widen(spanDestination, reinterpret_cast<const uint8_t*>(image.row(y) + spanStart), (spanEnd - spanStart) * 3);
+        float* destination = horizontal.data() + (static_cast<size_t>(y) * width + startX) * 3;
+        std::fill(destination, destination + (endX - startX) * 3, 0.0f);
+
+        // Channels are interleaved, so the tap kx of every channel of every pixel is the padded row shifted by 3 * kx floats
+        for (int k = 0; k < kernelSize; ++k) {
+            kernels.multiplyAdd(destination, padded.data() + k * 3, weights[k], (endX - startX) * 3);
+        }
+    }
+}
+
+// Convolve the tile [startX, endX) x [startY, endY) of the horizontal pass result vertically with the 1D kernel into the blurred image
+void applyGaussianVerticalPass(const std::vector<float>& horizontal, const std::vector<double>& kernel, Image& blurredImage, int startX, int startY, int endX, int endY) {
+    int width = blurredImage.width(), height = blurredImage.height(), halfSize = static_cast<int>(kernel.size()) / 2;
+    int tileFloats = (endX - startX) * 3;
+    const RowKernels& kernels = rowKernels();
+    std::vector<float> totals(tileFloats); // Accumulators for one output row of the tile (blue, green, red per pixel like the pixels in memory)
+
+    for (int y = startY; y < endY; ++y) {
+        std::fill(totals.begin(), totals.end(), 0.0f);
+        int kyStart = std::max(-halfSize, -y), kyEnd = std::min(halfSize, height - 1 - y);
+
+        // Walk the tile's span of each source row so the reads stay sequential
+        for (int ky = kyStart; ky <= kyEnd; ++ky) {
+            const float* source = horizontal.data() + (static_cast<size_t>(y + ky) * width + startX) * 3;
+            kernels.multiplyAdd(totals.data(), source, static_cast<float>(kernel[ky + halfSize]), tileFloats);
+        }
+
+        kernels.narrow(reinterpret_cast<uint8_t*>(blurredImage.row(y) + startX), totals.data(), tileFloats);
+    }
+}
+
+// Apply separable Gaussian blur to an image with one thread
+Image applySeparableGaussianBlurSingleThread(const Image& image, const std::vector<double>& kernel) {
+    int height = image.height(), width = image.width();
+    Image blurredImage(width, height);
+    std::vector<float> horizontal(static_cast<size_t>(width) * height * 3); // Result of the horizontal pass
+
+    applyGaussianHorizontalPass(image, kernel, horizontal, 0, 0, width, height);
+    applyGaussianVerticalPass(horizontal, kernel, blurredImage, 0, 0, width, height);
+
+    return blurredImage;
+}
+
+// Compute the sliding horizontal box sums of rows [startY, endY) (3 sums per pixel, each pixel costs one add and one subtract)
+void computeBoxBlurRowSums(const Image& image, int boxSize, std::vector<uint32_t>& rowSums, int startY, int endY) {
+    int width = image.width(), halfBoxSize = boxSize / 2;
+
+    for (int y = startY; y < endY; ++y) {
+        const RGB* source = image.row(y);
+        uint32_t* destination = rowSums.data() + static_cast<size_t>(y) * width * 3;
+        uint32_t totalRed = 0, totalGreen = 0, totalBlue = 0; // Running sums of the window centred on x
+
+        // Prime the window for x = 0 (only the right half is inside the image)
+        for (int x = 0; x <= std::min(halfBoxSize, width - 1); ++x) {
+            totalRed += source[x].red;
+            totalGreen += source[x].green;
+            totalBlue += source[x].blue;
+        }
 
-    // Iterate through each pixel in the image
-    for (int y = 0; y < height; ++y) {
         for (int x = 0; x < width; ++x) {
-            double totalRed = 0, totalGreen = 0, totalBlue = 0; // Initialize accumulators for each color channel
-            int count = 0; // Initialize a counter to keep track of the number of pixels averaged
-
-            // Iterate over a range of pixels in the motion direction (horizontal)
-            for (int mx = -halfLength; mx <= halfLength; ++mx) {
-                int currentX = x + mx; // Calculate the x-coordinate of the pixel to be considered
-                // Ensure the current pixel is within image bounds
-                if (currentX >= 0 && currentX < width) {
-                    const RGB& pixel = image[y][currentX]; // Access the pixel at the calculated position
-                    // Accumulate the color values of the pixel
-                    totalRed += pixel.red;
-                    totalGreen += pixel.green;
-                    totalBlue += pixel.blue;
-                    count++; // Increment the count of pixels considered
-                }
+            destination[x * 3] = totalRed;
+            destination[x * 3 + 1] = totalGreen;
+            destination[x * 3 + 2] = totalBlue;
+
+            // Slide the window one pixel right: the pixel entering on the right, the pixel leaving on the left
+            int entering = x + halfBoxSize + 1, leaving = x - halfBoxSize;
+            if (entering < width) {
+                totalRed += source[entering].red;
+                totalGreen += source[entering].green;
+                totalBlue += source[entering].blue;
+            }
+            if (leaving >= 0) {
+                totalRed -= source[leaving].red;
+                totalGreen -= source[leaving].green;
+                totalBlue -= source[leaving].blue;
             }
-
-            // Calculate the average color value for the target pixel and clamp the values to [0, 255]
-            blurredImage[y][x].red = std::clamp(static_cast<int>(totalRed / count), 0, 255);
-            blurredImage[y][x].green = std::clamp(static_cast<int>(totalGreen / count), 0, 255);
-            blurredImage[y][x].blue = std::clamp(static_cast<int>(totalBlue / count), 0, 255);
         }
     }
+}
+
+// Apply box blur to the image with one thread
+Image applyBoxBlurSingleThread(const Image& image, int boxSize) {
+    int height = image.height(), width = image.width(); // Dimensions of the input image
+    Image blurredImage(width, height); // Preparing the output image with the same dimensions
+    std::vector<uint32_t> rowSums(static_cast<size_t>(width) * height * 3); // Horizontal window sums of every row
+
+    // Sum horizontally, then slide a vertical window over the row sums
+    computeBoxBlurRowSums(image, boxSize, rowSums, 0, height);
+    applyBoxBlurToStrip(rowSums, blurredImage, boxSize, 0, height);
+
+    return blurredImage; // Return the blurred image
+}
+
+// Rasterize the motion direction into the line offsets walked by the motion blur
+MotionPath planMotionPath(int width, int height, double angle) {
+    TraceSpan span("motion path");
+    double dx = std::cos(angle * PI / 180.0), dy = -std::sin(angle * PI / 180.0); // Image rows grow downwards
+    MotionPath path;
+    path.xMajor = std::abs(dx) >= std::abs(dy);
+
+    // Step one pixel along the major axis per line position, the minor axis follows the slope
+    double slope = path.xMajor ? dy / dx : dx / dy;
+    path.mirrored = slope < 0; // Lines are symmetric, so flipping the minor axis keeps the offsets non-decreasing
+    slope = std::abs(slope);
+
+    int majorSize = path.xMajor ? width : height, minorSize = path.xMajor ? height : width;
+    path.offsets.resize(majorSize);
+    for (int i = 0; i < majorSize; ++i) {
+        path.offsets[i] = static_cast<int>(std::floor(i * slope + 0.5));
+    }
+
+    // Every line starting in [firstLine, endLine) crosses the image at least once
+    path.firstLine = -(majorSize > 0 ? path.offsets.back() : 0);
+    path.endLine = minorSize;
+    return path;
+}
+
+// Apply motion blur to the image based on a given motion length and angle with one thread
+Image applyMotionBlurSingleThread(const Image& image, int motionLength, double angle) {
+    int height = image.height(), width = image.width(); // Get the dimensions of the input image
+    Image blurredImage(width, height); // Prepare the output image with the same dimensions
+    MotionPath path = planMotionPath(width, height, angle); // Lines the blur averages along
+
+    applyMotionBlurSegment(image, blurredImage, path, path.firstLine, path.endLine, motionLength);
 
     return blurredImage; // Return the image with applied motion blur
 }
@@ -622,13 +3333,13 @@ double colorDistanceSingleThread(const RGB& color1, const RGB& color2) {
 }
 
 // Apply bucket fill to the other image using one thread with one thread
-std::vector<std::vector<RGB>> applyBucketFillSingleThread(const std::vector<std::vector<RGB>>& image, int threshold) {
-    int height = image.size(), width = image[0].size();
+Image applyBucketFillSingleThread(const Image& image, int threshold) {
+    int height = image.height(), width = image.width();
     const RGB fillColor  = {0, 255, 0}; // Green color
     int seedX = bucketFillX;
     int seedY = bucketFillY;
 
-    std::vector<std::vector<RGB>> bucketFilledImage = image;
+    Image bucketFilledImage = image;
     std::vector<std::vector<bool>> visited(height, std::vector<bool>(width, false));
 
     // Check if seed point is within the image
@@ -676,20 +3387,20 @@ double cubicInterpolateSingleThread(double p[4], double x) {
 // Function to perform bicubic interpolation on a 4x4 patch of an image
 double bicubicInterpolateSingleThread(double arr[4][4], double x, double y) {
     double colArr[4];
-    // Interpolates the values along the y-axis
+    // Interpolates each row (arr[row][column]) along the x-axis
     for (int i = 0; i < 4; i++) {
-        colArr[i] = cubicInterpolateSingleThread(arr[i], y);
+        colArr[i] = cubicInterpolateSingleThread(arr[i], x);
     }
-    // Interpolates the result along the x-axis
-    return cubicInterpolateSingleThread(colArr, x);
+    // Interpolates the results along the y-axis
+    return cubicInterpolateSingleThread(colArr, y);
 }
 
 // Function to resize an image using bicubic interpolation with one thread
-std::vector<std::vector<RGB>> resizeBicubicSingleThread(const std::vector<std::vector<RGB>>& image, int newWidth, int newHeight) {
-    int imgHeight = image.size();
-    int imgWidth = image[0].size();
+Image resizeBicubicSingleThread(const Image& image, int newWidth, int newHeight) {
+    int imgHeight = image.height();
+    int imgWidth = image.width();
 
-    std::vector<std::vector<RGB>> resized(newHeight, std::vector<RGB>(newWidth));
+    Image resized(newWidth, newHeight);
     double xRatio = static_cast<double>(imgWidth) / newWidth;
     double yRatio = static_cast<double>(imgHeight) / newHeight;
 
@@ -731,13 +3442,13 @@ std::vector<std::vector<RGB>> resizeBicubicSingleThread(const std::vector<std::v
 }
 
 // Function to resize an image using bilinear interpolation with one thread
-std::vector<std::vector<RGB>> resizeBilinearSingleThread(const std::vector<std::vector<RGB>>& image, int newWidth, int newHeight) {
-    int imgWidth = image[0].size();
-    int imgHeight = image.size();
+Image resizeBilinearSingleThread(const Image& image, int newWidth, int newHeight) {
+    int imgWidth = image.width();
+    int imgHeight = image.height();
 
-    std::vector<std::vector<RGB>> resized(newHeight, std::vector<RGB>(newWidth));
-    double xRatio = static_cast<double>(imgWidth - 1) / (newWidth - 1);
-    double yRatio = static_cast<double>(imgHeight - 1) / (newHeight - 1);
+    Image resized(newWidth, newHeight);
+    double xRatio = newWidth > 1 ? static_cast<double>(imgWidth - 1) / (newWidth - 1) : 0.0; // A single output column samples the first source column
+    double yRatio = newHeight > 1 ? static_cast<double>(imgHeight - 1) / (newHeight - 1) : 0.0;
 
     // Loop over each pixel in the new image
     for (int i = 0; i < newHeight; ++i) {
@@ -775,90 +3486,615 @@ std::vector<std::vector<RGB>> resizeBilinearSingleThread(const std::vector<std::
         }
     }
 
-    return resized;
+    return resized;
+}
+
+// Apply nearest neighbor resizing to the image with one thread
+Image nearestNeighborResizeSingleThread(const Image& image, int newWidth, int newHeight) {
+    int imageWidth = image.width();
+    int imageHeight = image.height();
+
+    double widthScale = (double)newWidth / imageWidth;
+    double heightScale = (double)newHeight / imageHeight;
+    
+    // Initialize the resizedImage with correct dimensions
+    Image resizedImage(newWidth, newHeight);
+
+    for (int y = 0; y < newHeight; y++) {
+        for (int x = 0; x < newWidth; x++) {
+            int originalX = (int)(x / widthScale);
+            int originalY = (int)(y / heightScale);
+
+            // Access elements correctly based on the dimensions
+            resizedImage[y][x] = image[originalY][originalX];
+        }
+    }
+
+    return resizedImage;
+}
+
+// Work out the taps and weights of every output position along one axis
+ResizeAxis planResizeAxis(ResizeFilter filter, int sourceSize, int size) {
+    TraceSpan span("resize plan");
+    ResizeAxis axis;
+    if (size <= 0 || sourceSize <= 0) return axis; // Nothing to resample (and no finite scale)
+    double scale = static_cast<double>(sourceSize) / size;
+
+    // Lanczos-3 stretches over more source pixels when shrinking so it keeps filtering out frequencies the output cannot hold
+    double filterScale = std::max(scale, 1.0), support = 3.0 * filterScale;
+    auto lanczos = [](double x) {
+        if (x == 0.0) return 1.0;
+        if (std::abs(x) >= 3.0) return 0.0;
+        return 3.0 * std::sin(PI * x) * std::sin(PI * x / 3.0) / (PI * PI * x * x);
+    };
+
+    switch (filter) {
+        case ResizeFilter::Bilinear: axis.taps = 2; break;
+        case ResizeFilter::Bicubic: axis.taps = 4; break;
+        case ResizeFilter::Lanczos3: axis.taps = static_cast<int>(std::ceil(2.0 * support)) + 1; break;
+    }
+    axis.indices.resize(static_cast<size_t>(size) * axis.taps);
+    axis.weights.resize(axis.indices.size());
+    axis.fixedWeights.resize(axis.indices.size());
+
+    std::vector<double> weights(axis.taps);
+    for (int i = 0; i < size; ++i) {
+        int* indices = &axis.indices[static_cast<size_t>(i) * axis.taps];
+        std::fill(weights.begin(), weights.end(), 0.0);
+
+        if (filter == ResizeFilter::Bilinear) {
+            // Corners map onto corners like resizeBilinear* ((size - 1) steps across (sourceSize - 1) pixels)
+            double ratio = size > 1 ? static_cast<double>(sourceSize - 1) / (size - 1) : 0.0;
+            double position = ratio * i;
+            int low = static_cast<int>(std::floor(position));
+            indices[0] = low;
+            indices[1] = std::min(low + 1, sourceSize - 1);
+            weights[0] = 1.0 - (position - low);
+            weights[1] = position - low;
+        } else if (filter == ResizeFilter::Bicubic) {
+            // Pixel centres map onto pixel centres like resizeBicubic*, with Catmull-Rom weights over the four nearest pixels
+            double position = (i + 0.5) * scale - 0.5;
+            int whole = int(position);
+            double t = position - whole;
+            for (int n = -1; n <= 2; ++n) {
+                indices[n + 1] = std::clamp(whole + n, 0, sourceSize - 1);
+            }
+            weights[0] = 0.5 * (-t + 2 * t * t - t * t * t);
+            weights[1] = 0.5 * (2 - 5 * t * t + 3 * t * t * t);
+            weights[2] = 0.5 * (t + 4 * t * t - 3 * t * t * t);
+            weights[3] = 0.5 * (-t * t + t * t * t);
+        } else {
+            // Every source pixel within the support of the centre, weights normalized so flat areas stay flat
+            double centre = (i + 0.5) * scale - 0.5;
+            int first = static_cast<int>(std::floor(centre - support)) + 1;
+            double sum = 0.0;
+            for (int k = 0; k < axis.taps; ++k) {
+                int source = first + k;
+                indices[k] = std::clamp(source, 0, sourceSize - 1);
+                weights[k] = source - centre < support ? lanczos((source - centre) / filterScale) : 0.0;
+                sum += weights[k];
+            }
+            for (double& weight : weights) {
+                weight /= sum;
+            }
+        }
+
+        for (int k = 0; k < axis.taps; ++k) {
+            axis.weights[static_cast<size_t>(i) * axis.taps + k] = static_cast<float>(weights[k]);
+        }
+        quantizeWeights(weights.data(), &axis.fixedWeights[static_cast<size_t>(i) * axis.taps], axis.taps);
+    }
+
+    return axis;
+}
+
+// Look up (or build and cache) the plan for resizing between two sizes with a filter
+std::shared_ptr<const ResizePlan> resizePlanFor(ResizeFilter filter, int sourceWidth, int sourceHeight, int width, int height) {
+    static std::mutex cacheMutex;
+    static std::vector<std::shared_ptr<const ResizePlan>> cache; // Least recently used first
+    std::lock_guard<std::mutex> lock(cacheMutex);
+
+    for (auto plan = cache.begin(); plan != cache.end(); ++plan) {
+        const ResizePlan& candidate = **plan;
+        if (candidate.filter == filter && candidate.sourceWidth == sourceWidth && candidate.sourceHeight == sourceHeight &&
+            candidate.width == width && candidate.height == height) {
+            auto hit = *plan;
+            cache.erase(plan);
+            cache.push_back(hit);
+            return hit;
+        }
+    }
+
+    auto plan = std::make_shared<const ResizePlan>(ResizePlan{filter, sourceWidth, sourceHeight, width, height,
+        planResizeAxis(filter, sourceWidth, width), planResizeAxis(filter, sourceHeight, height)});
+    if (cache.size() >= MaxCachedResizePlans) cache.erase(cache.begin());
+    cache.push_back(plan);
+    return plan;
+}
+
+// Resample the tile [startX, endX) x [startY, endY) of the source rows to the output width into a float buffer (3 floats per pixel in blue, green, red order)
+void resizeHorizontalPass(const Image& image, const ResizePlan& plan, std::vector<float>& horizontal, int startX, int startY, int endX, int endY) {
+    int taps = plan.columns.taps;
+
+    for (int y = startY; y < endY; ++y) {
+        const RGB* source = image.row(y);
+        float* destination = horizontal.data() + (static_cast<size_t>(y) * plan.width + startX) * 3;
+        for (int x = startX; x < endX; ++x, destination += 3) {
+            const int* indices = &plan.columns.indices[static_cast<size_t>(x) * taps];
+            const float* weights = &plan.columns.weights[static_cast<size_t>(x) * taps];
+            float totalBlue = 0, totalGreen = 0, totalRed = 0;
+            for (int k = 0; k < taps; ++k) {
+                const RGB& pixel = source[indices[k]];
+                totalBlue += pixel.blue * weights[k];
+                totalGreen += pixel.green * weights[k];
+                totalRed += pixel.red * weights[k];
+            }
+            destination[0] = totalBlue;
+            destination[1] = totalGreen;
+            destination[2] = totalRed;
+        }
+    }
+}
+
+// Resample the tile [startX, endX) x [startY, endY) of the output from the rows of the horizontal pass result
+void resizeVerticalPass(const std::vector<float>& horizontal, const ResizePlan& plan, Image& resized, int startX, int startY, int endX, int endY) {
+    int taps = plan.rows.taps, tileFloats = (endX - startX) * 3;
+    const RowKernels& kernels = rowKernels();
+    std::vector<float> totals(tileFloats);
+
+    for (int y = startY; y < endY; ++y) {
+        std::fill(totals.begin(), totals.end(), 0.0f);
+        const int* indices = &plan.rows.indices[static_cast<size_t>(y) * taps];
+        const float* weights = &plan.rows.weights[static_cast<size_t>(y) * taps];
+        for (int k = 0; k < taps; ++k) {
+            if (weights[k] == 0.0f) continue; // Padding taps
+            kernels.multiplyAdd(totals.data(), horizontal.data() + (static_cast<size_t>(indices[k]) * plan.width + startX) * 3, weights[k], tileFloats);
+        }
+        kernels.narrow(reinterpret_cast<uint8_t*>(resized.row(y) + startX), totals.data(), tileFloats);
+    }
+}
+
+// Resize an image along a resize plan with one thread
+Image resizeSeparableSingleThread(const Image& image, const ResizePlan& plan) {
+    Image resized(plan.width, plan.height);
+    std::vector<float> horizontal(static_cast<size_t>(plan.width) * plan.sourceHeight * 3); // Every source row resampled to the output width
+
+    resizeHorizontalPass(image, plan, horizontal, 0, 0, plan.width, plan.sourceHeight);
+    resizeVerticalPass(horizontal, plan, resized, 0, 0, plan.width, plan.height);
+
+    return resized;
+}
+
+// Build the 54 byte header of a 24 bit bottom-up BMP with the given dimensions
+void fillBmpHeader(unsigned char header[54], int width, int height) {
+    int rowPadding = (4 - (width * 3) % 4) % 4;
+    uint64_t fileSize = 54 + static_cast<uint64_t>(width * 3 + rowPadding) * height; // Adjust file size calculation for resizing
+
+    // Simple BMP header for a 24bit BMP
+    const unsigned char blank[54] = {
+        'B','M',  // Signature
+        0,0,0,0,  // Image file size in bytes
+        0,0,0,0,  // Reserved
+        54,0,0,0, // Start of pixel array
+        40,0,0,0, // Info header size
+        0,0,0,0,  // Image width
+        0,0,0,0,  // Image height
+        1,0,      // Number of color planes
+        24,0,     // Bits per pixel
+        0,0,0,0,  // Compression
+        0,0,0,0,  // Image size
+        0,0,0,0,  // Horizontal resolution
+        0,0,0,0,  // Vertical resolution
+        0,0,0,0,  // Colors in color table
+        0,0,0,0,  // Important color count
+    };
+    std::memcpy(header, blank, 54);
+
+    // Fill in the file size width and height in the header (the size field saturates for files past 4 GiB, readers go by the dimensions)
+    uint32_t storedSize = static_cast<uint32_t>(std::min<uint64_t>(fileSize, UINT32_MAX));
+    std::memcpy(&header[2], &storedSize, sizeof(storedSize));
+    std::memcpy(&header[18], &width, sizeof(width));
+    std::memcpy(&header[22], &height, sizeof(height));
+}
+
+// Check the 54 byte header of a BMP file of the given size and fill in where its rows are
+bool parseBmpHeader(const uint8_t header[54], uint64_t fileSize, BmpInfo& info) {
+    // Header fields (little endian like every platform we build on)
+    uint32_t dataOffset, compression;
+    int32_t width, height;
+    uint16_t bitsPerPixel;
+    std::memcpy(&dataOffset, header + 10, sizeof(dataOffset));
+    std::memcpy(&width, header + 18, sizeof(width));
+    std::memcpy(&height, header + 22, sizeof(height));
+    std::memcpy(&bitsPerPixel, header + 28, sizeof(bitsPerPixel));
+    std::memcpy(&compression, header + 30, sizeof(compression));
+    if (header[0] != 'B' || header[1] != 'M' || bitsPerPixel != 24 || compression != 0 || width <= 0 || height == 0 || height == INT32_MIN) {
+        std::cerr << "Only uncompressed 24 bit BMP files are supported!\n";
+        return false;
+    }
+
+    info.width = width;
+    info.height = std::abs(height);
+    info.topDown = height < 0;
+    info.dataOffset = dataOffset;
+    info.rowSize = (static_cast<uint64_t>(width) * sizeof(RGB) + 3) & ~static_cast<uint64_t>(3); // Rows are padded to 4 bytes
+    if (info.dataOffset > fileSize || info.rowSize * info.height > fileSize - info.dataOffset) {
+        std::cerr << "BMP file is truncated!\n";
+        return false;
+    }
+    return true;
+}
+
+// Read rows [firstRow, firstRow + rowCount) of an open BMP (row 0 is the bottom row) into an image
+Image readBmpRows(std::ifstream& file, const BmpInfo& info, int firstRow, int rowCount) {
+    Image image(info.width, rowCount);
+    std::vector<char> buffer(info.rowSize * rowCount);
+
+    // The rows are contiguous in the file either way, top-down files just store them in the opposite order
+    int firstStored = info.topDown ? info.height - (firstRow + rowCount) : firstRow;
+    file.seekg(static_cast<std::streamoff>(info.dataOffset + info.rowSize * firstStored));
+    file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    for (int y = 0; y < rowCount; ++y) {
+        int stored = info.topDown ? rowCount - 1 - y : y;
+        std::memcpy(image.row(y), buffer.data() + info.rowSize * stored, image.rowBytes());
+    }
+    return image;
+}
+
+// Append rows [startRow, endRow) of an image to a BMP being streamed out (with their padding)
+void appendBmpRows(std::ofstream& file, const Image& image, int startRow, int endRow) {
+    const char padding[3] = {0, 0, 0};
+    int rowPadding = (4 - (image.width() * 3) % 4) % 4;
+    for (int y = startRow; y < endRow; ++y) {
+        file.write(reinterpret_cast<const char*>(image.row(y)), static_cast<std::streamsize>(image.rowBytes()));
+        file.write(padding, rowPadding);
+    }
+}
+
+// Cut the output rows [startRow, endRow) out of a resize plan, reading only the source rows they need (firstSourceRow is where those start)
+ResizePlan slicePlanRows(const ResizePlan& plan, int startRow, int endRow, int& firstSourceRow) {
+    int taps = plan.rows.taps;
+    if (startRow >= endRow) { // No output rows read no source rows
+        firstSourceRow = 0;
+        ResizePlan band = {plan.filter, plan.sourceWidth, 0, plan.width, 0, plan.columns, {}};
+        band.rows.taps = taps;
+        return band;
+    }
+    auto tapsBegin = plan.rows.indices.begin() + static_cast<std::ptrdiff_t>(startRow) * taps;
+    auto tapsEnd = plan.rows.indices.begin() + static_cast<std::ptrdiff_t>(endRow) * taps;
+
+    // Source rows with a weight in the band (padding taps are clamped into the range instead)
+    int lastSourceRow = 0;
+    firstSourceRow = plan.sourceHeight;
+    for (auto tap = tapsBegin; tap != tapsEnd; ++tap) {
+        if (plan.rows.weights[tap - plan.rows.indices.begin()] == 0.0f) continue;
+        firstSourceRow = std::min(firstSourceRow, *tap);
+        lastSourceRow = std::max(lastSourceRow, *tap);
+    }
+    if (firstSourceRow > lastSourceRow) firstSourceRow = lastSourceRow = *tapsBegin;
+
+    ResizePlan band = {plan.filter, plan.sourceWidth, lastSourceRow - firstSourceRow + 1, plan.width, endRow - startRow, plan.columns, {}};
+    band.rows.taps = taps;
+    band.rows.indices.assign(tapsBegin, tapsEnd);
+    for (int& index : band.rows.indices) {
+        index = std::clamp(index - firstSourceRow, 0, band.sourceHeight - 1);
+    }
+    band.rows.weights.assign(plan.rows.weights.begin() + (tapsBegin - plan.rows.indices.begin()), plan.rows.weights.begin() + (tapsEnd - plan.rows.indices.begin()));
+    band.rows.fixedWeights.assign(plan.rows.fixedWeights.begin() + (tapsBegin - plan.rows.indices.begin()), plan.rows.fixedWeights.begin() + (tapsEnd - plan.rows.indices.begin()));
+    return band;
+}
+
+// Set up a pipeline stage running the named operation on a width x height input (false for unknown operations and empty resize targets)
+bool planPipelineStage(const std::string& name, int width, int height, PipelineStage& stage) {
+    stage = PipelineStage{};
+    stage.name = name;
+    stage.inputWidth = width;
+    stage.inputHeight = height;
+    stage.width = width;
+    stage.height = height;
+
+    // Filters keep the size and read halo rows on both sides of a band (the filtered halo rows are thrown away)
+    auto rowFilter = [&](int halo, std::function<Image(const Image&)> filter) {
+        stage.inputRows = [halo, height](int startRow, int endRow) { return std::make_pair(std::max(startRow - halo, 0), std::min(endRow + halo, height)); };
+        stage.run = [filter](const Image& input, int firstRow, int startRow, int endRow) { return filter(input).rowRange(startRow - firstRow, endRow - startRow); };
+    };
+    // Operations that need the whole input always get all of it
+    auto wholeImage = [&](std::function<Image(const Image&)> operation) {
+        stage.banded = false;
+        stage.inputRows = [height](int, int) { return std::make_pair(0, height); };
+        stage.run = [operation](const Image& input, int, int, int) { return operation(input); };
+    };
+    // Resizes need a target of at least one pixel
+    auto validTarget = [&](int newWidth, int newHeight) {
+        if (newWidth > 0 && newHeight > 0) return true;
+        std::cerr << "Resize target must be at least 1x1 for " << name << ", not " << newWidth << "x" << newHeight << std::endl;
+        return false;
+    };
+    // Resizes run the slice of the plan covering the band (false for an empty target)
+    auto planResize = [&](ResizeFilter filter, int newWidth, int newHeight) {
+        if (!validTarget(newWidth, newHeight)) return false;
+        auto plan = resizePlanFor(filter, width, height, newWidth, newHeight);
+        stage.width = newWidth;
+        stage.height = newHeight;
+        stage.inputRows = [plan](int startRow, int endRow) {
+            int firstSourceRow;
+            ResizePlan band = slicePlanRows(*plan, startRow, endRow, firstSourceRow);
+            return std::make_pair(firstSourceRow, firstSourceRow + band.sourceHeight);
+        };
+        stage.run = [plan](const Image& input, int firstRow, int startRow, int endRow) {
+            int firstSourceRow;
+            ResizePlan band = slicePlanRows(*plan, startRow, endRow, firstSourceRow);
+            return resizeSeparableMultipleThreads(input.rowRange(firstSourceRow - firstRow, band.sourceHeight), band);
+        };
+        return true;
+    };
+
+    if (name == "gaussianBlur") {
+        stage.label = "Gaussian blur";
+        stage.outputFilename = GaussianBlurredOutputFilename;
+        if (separableGaussianBlur) {
+            auto kernel = gaussianKernel1DFor(sigma);
+            rowFilter(static_cast<int>(kernel->size()) / 2, [kernel](const Image& input) { return applySeparableGaussianBlurMultipleThreads(input, *kernel); });
+        } else {
+            auto kernel = gaussianKernel2DFor(sigma);
+            rowFilter(static_cast<int>(kernel->size()) / 2, [kernel](const Image& input) { return applyGaussianBlurMultipleThreads(input, *kernel); });
+        }
+    } else if (name == "boxBlur") {
+        stage.label = "box blur";
+        stage.outputFilename = BoxBlurredOutputFilename;
+        rowFilter(boxSize / 2, [](const Image& input) { return applyBoxBlurMultipleThreads(input, boxSize); });
+    } else if (name == "motionBlur") {
+        stage.label = "motion blur";
+        stage.outputFilename = MotionBlurredOutputFilename;
+        auto blur = [](const Image& input) { return applyMotionBlurMultipleThreads(input, motionLength, motionAngle); };
+        if (motionAngle == 0.0) {
+            rowFilter(0, blur); // Horizontal lines stay within their row
+        } else {
+            wholeImage(blur);
+        }
+    } else if (name == "bucketFill") {
+        stage.label = "bucket fill";
+        stage.outputFilename = BucketFillOutputFilename;
+        wholeImage([](const Image& input) { return applyBucketFillMultipleThreads(input, bucketFillThreshold); });
+    } else if (name == "bilinearResize") {
+        stage.label = "bilinear resizing";
+        stage.outputFilename = BilinearResizedOutputFilename;
+        if (!planResize(ResizeFilter::Bilinear, resizeWidthBilinear, resizeHeightBilinear)) return false;
+    } else if (name == "bicubicResize") {
+        stage.label = "bicubic resizing";
+        stage.outputFilename = BicubicResizedOutputFilename;
+        if (!planResize(ResizeFilter::Bicubic, resizeWidthBicubic, resizeHeightBicubic)) return false;
+    } else if (name == "lanczosResize") {
+        stage.label = "Lanczos-3 resizing";
+        stage.outputFilename = LanczosResizedOutputFilename;
+        if (!planResize(ResizeFilter::Lanczos3, resizeWidthLanczos, resizeHeightLanczos)) return false;
+    } else if (name == "nearestNeighborResize") {
+        stage.label = "nearest neighbor resizing";
+        stage.outputFilename = nearestNeighborResizedOutputFilename;
+        if (!validTarget(resizeWidthNearestNeighbor, resizeHeightNearestNeighbor)) return false;
+        stage.width = resizeWidthNearestNeighbor;
+        stage.height = resizeHeightNearestNeighbor;
+
+        // Same source pixels as nearestNeighborResizeMultipleThreads, with the columns looked up once
+        double widthScale = static_cast<double>(stage.width) / width;
+        double heightScale = static_cast<double>(stage.height) / height;
+        auto sourceRow = [heightScale, height](int y) { return std::min(static_cast<int>(std::floor(y / heightScale)), height - 1); };
+        auto columns = std::make_shared<std::vector<int>>(stage.width);
+        for (int x = 0; x < stage.width; ++x) {
+            (*columns)[x] = std::min(static_cast<int>(std::floor(x / widthScale)), width - 1);
+        }
+        stage.inputRows = [sourceRow](int startRow, int endRow) { return std::make_pair(sourceRow(startRow), sourceRow(endRow - 1) + 1); };
+        stage.run = [sourceRow, columns](const Image& input, int firstRow, int startRow, int endRow) {
+            Image resized(static_cast<int>(columns->size()), endRow - startRow);
+            ThreadPool::instance().parallelFor(endRow - startRow, [&](int begin, int end) {
+                for (int y = begin; y < end; ++y) {
+                    const RGB* source = input.row(sourceRow(startRow + y) - firstRow);
+                    RGB* destination = resized.row(y);
+                    for (size_t x = 0; x < columns->size(); ++x) {
+                        destination[x] = source[(*columns)[x]];
+                    }
+                }
+            });
+            return resized;
+        };
+    } else {
+        std::cerr << "Unknown function: " << name << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Set up the stages of a pipeline on a width x height input (false if one of the operations is unknown)
+bool planPipeline(const std::vector<std::string>& names, int width, int height, std::vector<PipelineStage>& stages) {
+    stages.resize(names.size());
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (!planPipelineStage(names[i], width, height, stages[i])) {
+            return false;
+        }
+        width = stages[i].width;
+        height = stages[i].height;
+    }
+    return !stages.empty();
+}
+
+// Input rows of stages[first] read by the output rows [startRow, endRow) of stages[last - 1]
+std::pair<int, int> pipelineInputRows(const std::vector<PipelineStage>& stages, size_t first, size_t last, int startRow, int endRow) {
+    std::pair<int, int> rows = {startRow, endRow};
+    for (size_t i = last; i-- > first;) {
+        rows = stages[i].inputRows(rows.first, rows.second);
+    }
+    return rows;
+}
+
+// Output rows of stages[last - 1] per band so the widest intermediate of a band takes about budget bytes
+int pipelineBandRows(const std::vector<PipelineStage>& stages, size_t first, size_t last, uint64_t budget) {
+    int outputHeight = stages[last - 1].height;
+    // Bytes a band of the given output rows (taken from the middle of the image) holds of its widest intermediate halos included, about 6 bytes per pixel byte with the filters' scratch buffers
+    auto bandBytes = [&](int rows) {
+        int startRow = (outputHeight - rows) / 2;
+        std::pair<int, int> span = {startRow, startRow + rows};
+        uint64_t widest = static_cast<uint64_t>(stages[last - 1].width) * rows;
+        for (size_t i = last; i-- > first;) {
+            span = stages[i].inputRows(span.first, span.second);
+            widest = std::max(widest, static_cast<uint64_t>(stages[i].inputWidth) * (span.second - span.first));
+        }
+        return widest * sizeof(RGB) * 6;
+    };
+
+    // Halo of all the stages together in output rows: the input rows one output row reads beyond its share of the input
+    std::pair<int, int> oneRow = pipelineInputRows(stages, first, last, outputHeight / 2, outputHeight / 2 + 1);
+    double inputPerOutputRow = static_cast<double>(stages[first].inputHeight) / std::max(outputHeight, 1);
+    int halo = static_cast<int>(std::ceil((oneRow.second - oneRow.first - inputPerOutputRow) / inputPerOutputRow));
+
+    // The most rows that fit, but at least 4 halos (the stages still read their input halos for every band, even with the shared output rows carried over)
+    int low = std::min(std::max(8, 4 * halo), outputHeight), high = outputHeight;
+    while (low < high) {
+        int rows = low + (high - low + 1) / 2;
+        if (bandBytes(rows) <= budget) low = rows; else high = rows - 1;
+    }
+    return low;
 }
 
-// Apply nearest neighbor resizing to the image with one thread
-std::vector<std::vector<RGB>> nearestNeighborResizeSingleThread(const std::vector<std::vector<RGB>>& image, int newWidth, int newHeight) {
-    int imageWidth = image[0].size();
-    int imageHeight = image.size();
+// Run banded stages[first, last) over the output rows [outputFirstRow, outputFirstRow + output height) one cache sized band after another (source starts at sourceFirstRow)
+void runPipelineBands(const std::vector<PipelineStage>& stages, size_t first, size_t last, const Image& source, int sourceFirstRow, Image& output, int outputFirstRow) {
+    int bandRows = pipelineBandRows(stages, first, last, PipelineBandBytes);
+    int bands = (output.height() + bandRows - 1) / bandRows;
+    size_t count = last - first;
+
+    // Every thread runs a contiguous run of bands through all the stages back to back (the operations' own parallelFor calls run inline), so each stage reads the previous one's rows from cache
+    ThreadPool::instance().parallelFor(bands, [&](int startBand, int endBand) {
+        // Rows of the input and of every stage's output the previous band produced, the halo rows it shares with the next band are copied over instead of recomputed
+        std::vector<Image> windows(count + 1);
+        std::vector<std::pair<int, int>> held(count + 1, {0, 0});
+        for (int bandIndex = startBand; bandIndex < endBand; ++bandIndex) {
+            int startRow = outputFirstRow + bandIndex * bandRows, endRow = std::min(startRow + bandRows, outputFirstRow + output.height());
+
+            // Walk back from the band to the rows every stage has to produce, then run the stages forward
+            std::vector<std::pair<int, int>> rows(count + 1);
+            rows[count] = {startRow, endRow};
+            for (size_t i = last; i-- > first;) {
+                rows[i - first] = stages[i].inputRows(rows[i - first + 1].first, rows[i - first + 1].second);
+            }
+            windows[0] = source.rowRange(rows[0].first - sourceFirstRow, rows[0].second - rows[0].first);
+            for (size_t i = 1; i <= count; ++i) {
+                const PipelineStage& stage = stages[first + i - 1];
+                auto [start, end] = rows[i];
+                int computeFrom = start; // Rows from here on are new, the ones before are still in the previous window
+                if (held[i].first <= start && start < held[i].second) computeFrom = std::min(held[i].second, end);
+
+                Image window;
+                if (computeFrom < end) {
+                    auto [inputStart, inputEnd] = stage.inputRows(computeFrom, end);
+                    window = stage.run(windows[i - 1].rowRange(inputStart - rows[i - 1].first, inputEnd - inputStart), inputStart, computeFrom, end);
+                }
+                if (computeFrom > start) {
+                    Image carried(stage.width, end - start);
+                    for (int y = start; y < end; ++y) {
+                        const Image& from = y < computeFrom ? windows[i] : window;
+                        std::memcpy(carried.row(y - start), from.row(y - (y < computeFrom ? held[i].first : computeFrom)), carried.rowBytes());
+                    }
+                    window = std::move(carried);
+                }
+                windows[i] = std::move(window);
+                held[i] = rows[i];
+            }
 
-    double widthScale = (double)newWidth / imageWidth;
-    double heightScale = (double)newHeight / imageHeight;
-    
-    // Initialize the resizedImage with correct dimensions
-    std::vector<std::vector<RGB>> resizedImage(newHeight, std::vector<RGB>(newWidth));
+            for (int y = startRow; y < endRow; ++y) {
+                std::memcpy(output.row(y - outputFirstRow), windows[count].row(y - startRow), output.rowBytes());
+            }
+        }
+    });
+}
 
-    for (int y = 0; y < newHeight; y++) {
-        for (int x = 0; x < newWidth; x++) {
-            int originalX = (int)(x / widthScale);
-            int originalY = (int)(y / heightScale);
+// Run a pipeline one full size image per stage
+Image runPipelineUnfused(const Image& image, const std::vector<PipelineStage>& stages) {
+    Image current = image.rowRange(0, image.height());
+    for (const auto& stage : stages) {
+        current = stage.run(current, 0, 0, stage.height);
+    }
+    return current;
+}
 
-            // Access elements correctly based on the dimensions
-            resizedImage[y][x] = image[originalY][originalX];
+// Run a pipeline fused into row bands (stages needing their whole input run on their own between the fused runs)
+Image runPipelineFused(const Image& image, const std::vector<PipelineStage>& stages) {
+    Image current = image.rowRange(0, image.height());
+    for (size_t first = 0; first < stages.size();) {
+        if (!stages[first].banded) {
+            current = stages[first].run(current, 0, 0, stages[first].height);
+            ++first;
+            continue;
         }
-    }
 
-    return resizedImage;
+        size_t last = first + 1;
+        while (last < stages.size() && stages[last].banded) ++last;
+        Image output(stages[last - 1].width, stages[last - 1].height);
+        runPipelineBands(stages, first, last, current, 0, output, 0);
+        current = std::move(output);
+        first = last;
+    }
+    return current;
 }
 
-// Save the new image data by copying the original file and replacing the header (for resize) and pixel color data with one thread
-void writeBmp(const std::string& filename, const std::vector<std::vector<RGB>>& image, bool resize, int resizedWidth, int resizedHeight) {
+// Save the new image data by copying the original file and replacing the header (for resize) and pixel color data  with one thread
+void writeBmp(const std::string& filename, const Image& image, bool resize, int resizedWidth, int resizedHeight) {
+    TraceSpan span("write (single thread)");
+    int width = resize ? resizedWidth : image.width();
+    int height = resize ? resizedHeight : image.height();
+    int rowPadding = (4 - (width * 3) % 4) % 4;
+    size_t pixelBytes = static_cast<size_t>(std::min(width, image.width())) * sizeof(RGB); // Bytes of a row taken from the image
+    unsigned char header[54];
+    fillBmpHeader(header, width, height);
+
+    // Rows beyond the image (when resizing) are black, the rest of every row is padding
+    std::vector<char> zeros(static_cast<size_t>(width) * sizeof(RGB) + rowPadding, 0);
+
+#ifdef _WIN32
     std::ofstream outFile(filename, std::ios::binary);
     if (!outFile) {
         std::cerr << "Could not open output file for writing." << std::endl;
         return;
     }
-
-    int width = resize ? resizedWidth : image[0].size();
-    int height = resize ? resizedHeight : image.size();
-    int rowPadding = (4 - (width * 3) % 4) % 4;
-    int fileSize = 54 + (width * 3 + rowPadding) * height; // Adjust file size calculation for resizing
-
-    // Simple BMP header for a 24bit BMP
-    unsigned char header[54] = {
-        'B','M',  // Signature
-        0,0,0,0,  // Image file size in bytes
-        0,0,0,0,  // Reserved
-        54,0,0,0, // Start of pixel array
-        40,0,0,0, // Info header size
-        0,0,0,0,  // Image width
-        0,0,0,0,  // Image height
-        1,0,      // Number of color planes
-        24,0,     // Bits per pixel
-        0,0,0,0,  // Compression
-        0,0,0,0,  // Image size
-        0,0,0,0,  // Horizontal resolution
-        0,0,0,0,  // Vertical resolution
-        0,0,0,0,  // Colors in color table
-        0,0,0,0,  // Important color count
-    };
-
-    // Fill in the file size widthand height in the header
-    *reinterpret_cast<int*>(&header[2]) = fileSize;
-    *reinterpret_cast<int*>(&header[18]) = width;
-    *reinterpret_cast<int*>(&header[22]) = height;
-
-    // Write the header
     outFile.write(reinterpret_cast<const char*>(header), 54);
+    for (int y = 0; y < height; y++) {
+        bool inImage = y < image.height();
+        outFile.write(inImage ? reinterpret_cast<const char*>(image.row(y)) : zeros.data(), inImage ? pixelBytes : 0);
+        outFile.write(zeros.data(), zeros.size() - (inImage ? pixelBytes : 0));
+    }
+#else
+    int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::cerr << "Could not open output file for writing." << std::endl;
+        return;
+    }
 
-    // Write the pixel data
+    // Gather the header and every row straight from the image (no copy) and hand them to the kernel IOV_MAX pieces at a time
+    std::vector<iovec> pieces;
+    pieces.reserve(static_cast<size_t>(height) * 2 + 1);
+    pieces.push_back({header, 54});
     for (int y = 0; y < height; y++) {
-        if (!resize || y < image.size()) {
-            // When not resizing or within original height, write row directly
-            outFile.write(reinterpret_cast<const char*>(image[y].data()), image[y].size() * sizeof(RGB));
-        } else {
-            // If resizing and beyond original image, fill with black pixels
-            for (int x = 0; x < width; x++) {
-                RGB blackPixel = {0, 0, 0};
-                outFile.write(reinterpret_cast<const char*>(&blackPixel), sizeof(RGB));
-            }
+        size_t fromImage = y < image.height() ? pixelBytes : 0;
+        if (fromImage > 0) pieces.push_back({const_cast<RGB*>(image.row(y)), fromImage});
+        if (zeros.size() > fromImage) pieces.push_back({zeros.data(), zeros.size() - fromImage});
+    }
+
+    for (size_t first = 0; first < pieces.size();) {
+        int count = static_cast<int>(std::min<size_t>(pieces.size() - first, IOV_MAX));
+        ssize_t written = writev(fd, &pieces[first], count);
+        if (written < 0) {
+            std::cerr << "Could not write output file." << std::endl;
+            break;
         }
-        // Padding for alignment
-        for (int i = 0; i < rowPadding; ++i) {
-            outFile.put(0);
+        // Skip what was written, a short write leaves the rest of a piece for the next call
+        while (written > 0 && first < pieces.size()) {
+            size_t step = std::min(static_cast<size_t>(written), pieces[first].iov_len);
+            pieces[first].iov_base = static_cast<char*>(pieces[first].iov_base) + step;
+            pieces[first].iov_len -= step;
+            written -= static_cast<ssize_t>(step);
+            if (pieces[first].iov_len == 0) ++first;
         }
     }
+    close(fd);
+#endif
 }
 
 // Thread function to read rows
@@ -874,14 +4110,15 @@ void readRowsMultipleThreads(const ThreadData* data) {
     std::vector<char> buffer(dataSize - data->rowPadding); // Buffer to read pixel data into, excluding padding
 
     for (int y = data->startRow; y < data->endRow; ++y) {
-        bmpFile.seekg(data->headerOffset + y * dataSize, std::ios::beg);
+        bmpFile.seekg(data->headerOffset + static_cast<std::streamoff>(y) * dataSize, std::ios::beg); // 64 bit offsets, y * dataSize overflows past 2 GiB
         bmpFile.read(buffer.data(), buffer.size());
-        std::memcpy((*data->image)[y].data(), buffer.data(), buffer.size());
+        std::memcpy(data->image->row(y), buffer.data(), buffer.size());
     }
 }
 
 // Function to read BMP images utilizing multiple threads
-std::vector<std::vector<RGB>> readBmpMultipleThreads(const std::string& filename) {
+Image readBmpMultipleThreads(const std::string& filename) {
+    TraceSpan span("parse (multiple threads)");
     // Open the BMP file to read width and height
     std::ifstream bmpFile(filename, std::ios::binary);
     if (!bmpFile) {
@@ -896,92 +4133,87 @@ std::vector<std::vector<RGB>> readBmpMultipleThreads(const std::string& filename
     int rowPadding = (4 - (width * 3) % 4) % 4;
 
     // Initialize the image storage
-    std::vector<std::vector<RGB>> image(height, std::vector<RGB>(width));
-
-    // Determine the number of threads to use
-    unsigned numThreads = std::thread::hardware_concurrency();
-    std::vector<std::thread> threads;
-    std::vector<ThreadData> threadData(numThreads);
-
-    // Distribute rows among threads
-    int rowsPerThread = height / numThreads;
-    for (int i = 0; i < numThreads; ++i) {
-        threadData[i] = {i * rowsPerThread,
-                         (i == numThreads - 1) ? height : (i + 1) * rowsPerThread,
-                         &filename, // Pass address of filename
-                         &image,
-                         width,
-                         rowPadding};
-                         
-        threads.emplace_back(readRowsMultipleThreads, &threadData[i]);
-    }
-
-    // Wait for all threads to finish
-    for (auto& t : threads) {
-        t.join();
-    }
+    Image image(width, height);
+
+    // Distribute rows among the pool threads
+    ThreadPool::instance().parallelFor(height, [&](int startRow, int endRow) {
+        ThreadData threadData = {startRow,
+                                 endRow,
+                                 &filename, // Pass address of filename
+                                 &image,
+                                 width,
+                                 rowPadding};
+        readRowsMultipleThreads(&threadData);
+    });
 
     return image;
 }
 
-// Generate the Gaussian kernel with multiple threads
-std::vector<std::vector<double>> generateGaussianKernelMultipleThreads(double sigma) {
-    // Calculate the kernel size to ensure it's odd
-    int kernelSize = static_cast<int>(std::round(6 * sigma)) | 1;
-    // Initialize the kernel matrix with the calculated size
-    std::vector<std::vector<double>> kernel(kernelSize, std::vector<double>(kernelSize));
-    double sum = 0.0; // Sum of all elements for normalization
-    int halfSize = kernelSize / 2; // Half the kernel size for indexing
-    std::mutex sumMutex; // Mutex for thread-safe sum updates
-    
-    // Worker lambda function for parallel computation of kernel values
-    auto worker = [&](int startX, int endX) {
-        double localSum = 0.0; // Local sum for elements computed by this thread
-        for (int x = startX; x <= endX; x++) {
-            for (int y = -halfSize; y <= halfSize; y++) {
-                double exponent = -(x * x + y * y) / (2 * sigma * sigma);
-                double value = std::exp(exponent) / (2 * PI * sigma * sigma);
-                kernel[x + halfSize][y + halfSize] = value;
-                localSum += value; // Update local sum
-            }
-        }
-        std::lock_guard<std::mutex> lock(sumMutex); // Lock guard for thread-safe update of global sum
-        sum += localSum; // Update global sum
-    };
-
-    // Determine the number of threads to use
-    const unsigned int numThreads = std::thread::hardware_concurrency();
-    std::vector<std::thread> threads; // Vector to store threads
-    int rowsPerThread = kernelSize / numThreads; // Divide work evenly among threads
-    for (unsigned int i = 0; i < numThreads; ++i) {
-        int start = -halfSize + i * rowsPerThread; // Calculate start index for this thread
-        int end = i == numThreads - 1 ? halfSize : -halfSize + (i + 1) * rowsPerThread - 1; // Calculate end index for this thread
-        threads.emplace_back(worker, start, end); // Create and start a new thread
+// Read a 24 bit BMP by memory mapping it, copying the rows into an aligned image on the pool or (zeroCopy) viewing them in place
+Image readBmpMapped(const std::string& filename, bool zeroCopy) {
+    TraceSpan span("parse (memory mapped)");
+#ifdef _WIN32
+    (void)zeroCopy;
+    return readBmpMultipleThreads(filename); // No mmap here, use the stream reader
+#else
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Could not open BMP file!\n";
+        return {};
+    }
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size < 54) {
+        std::cerr << "Could not read BMP header!\n";
+        close(fd);
+        return {};
     }
 
-    for (auto& t : threads) {
-        t.join(); // Wait for all threads to finish
+    // A private writable mapping, so a zero copy image can be written to without touching the file (pages are copied on write)
+    size_t fileSize = static_cast<size_t>(fileStat.st_size);
+    void* mapping = mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping keeps its own reference to the file
+    if (mapping == MAP_FAILED) {
+        std::cerr << "Could not map BMP file!\n";
+        return {};
     }
+    std::shared_ptr<void> owner(mapping, [fileSize](void* address) { munmap(address, fileSize); });
+    madvise(mapping, fileSize, MADV_SEQUENTIAL); // Rows are read front to back
+    madvise(mapping, fileSize, MADV_WILLNEED); // Start reading ahead right away
 
-    // Normalize the kernel by dividing each element by the sum of all elements
-    for (auto& row : kernel) {
-        for (double& value : row) {
-            value /= sum;
-        }
+    uint8_t* bytes = static_cast<uint8_t*>(mapping);
+    BmpInfo info;
+    if (!parseBmpHeader(bytes, fileSize, info)) {
+        return {};
+    }
+    int width = info.width, rows = info.height;
+
+    // Row 0 is the first row of a bottom-up file; a top-down file (negative height) is walked backwards so row 0 is still the bottom row
+    uint8_t* firstRow = bytes + info.dataOffset + (info.topDown ? (rows - 1) * info.rowSize : 0);
+    std::ptrdiff_t stride = info.topDown ? -static_cast<std::ptrdiff_t>(info.rowSize) : static_cast<std::ptrdiff_t>(info.rowSize);
+    Image mapped(firstRow, width, rows, stride, std::move(owner)); // The row padding is skipped through the stride
+    if (zeroCopy) {
+        return mapped;
     }
 
-    return kernel; // Return the generated and normalized kernel
+    Image image(width, rows);
+    ThreadPool::instance().parallelFor(rows, [&](int startRow, int endRow) {
+        for (int y = startRow; y < endRow; ++y) {
+            std::memcpy(image.row(y), mapped.row(y), image.rowBytes());
+        }
+    });
+    return image;
+#endif
 }
 
 // Apply Gaussian blur to an image with multiple threads
-std::vector<std::vector<RGB>> applyGaussianBlurMultipleThreads(const std::vector<std::vector<RGB>>& image, const std::vector<std::vector<double>>& kernel) {
-    int height = image.size(), width = image[0].size(), kernelSize = kernel.size(); // Image and kernel dimensions
-    std::vector<std::vector<RGB>> blurredImage(height, std::vector<RGB>(width)); // Initialize the blurred image matrix
-
-    // Worker lambda function for applying Gaussian blur in parallel
-    auto worker = [&](int startRow, int endRow) {
-        for (int y = startRow; y <= endRow; ++y) {
-            for (int x = 0; x < width; ++x) {
+Image applyGaussianBlurMultipleThreads(const Image& image, const std::vector<std::vector<double>>& kernel) {
+    int height = image.height(), width = image.width(), kernelSize = kernel.size(); // Image and kernel dimensions
+    Image blurredImage(width, height); // Initialize the blurred image
+
+    // Worker lambda function for applying Gaussian blur to one tile in parallel
+    auto worker = [&](int startX, int startY, int endX, int endY) {
+        for (int y = startY; y < endY; ++y) {
+            for (int x = startX; x < endX; ++x) {
                 double totalRed = 0, totalGreen = 0, totalBlue = 0; // Accumulators for color channels
                 for (int ky = -kernelSize / 2; ky <= kernelSize / 2; ++ky) {
                     for (int kx = -kernelSize / 2; kx <= kernelSize / 2; ++kx) {
@@ -1005,157 +4237,259 @@ std::vector<std::vector<RGB>> applyGaussianBlurMultipleThreads(const std::vector
         }
     };
 
-    // Determine the number of threads to use
-    const unsigned int numThreads = std::thread::hardware_concurrency();
-    std::vector<std::thread> threads; // Vector to store threads
-    int rowsPerThread = height / numThreads; // Divide work evenly among threads
-    for (unsigned int i = 0; i < numThreads; ++i) {
-        // Calculate the start and end row for each thread
-        int startRow = i * rowsPerThread;
-        int endRow = i == numThreads - 1 ? height - 1 : (i + 1) * rowsPerThread - 1;
-        threads.emplace_back(worker, startRow, endRow); // Create and start a new thread
+    // Schedule the tiles on the pool threads and wait for them to complete their work
+    ThreadPool::instance().parallelForTiles(width, height, tileSize, tileSize, worker);
+
+    return blurredImage; // Return the blurred image
+}
+
+// Apply separable Gaussian blur to an image with multiple threads (both passes split into tiles)
+Image applySeparableGaussianBlurMultipleThreads(const Image& image, const std::vector<double>& kernel) {
+    int height = image.height(), width = image.width();
+    Image blurredImage(width, height);
+    std::vector<float> horizontal(fixedPoint ? 0 : static_cast<size_t>(width) * height * 3); // Result of the horizontal pass
+
+    // Run one pass on the pool and wait before the next (the vertical pass reads rows from neighbouring tiles of the horizontal pass)
+    ThreadPool& pool = ThreadPool::instance();
+    if (fixedPoint) {
+        std::vector<int16_t> weights(kernel.size());
+        quantizeWeights(kernel.data(), weights.data(), static_cast<int>(kernel.size()));
+        std::vector<int16_t> fixedHorizontal(static_cast<size_t>(width) * height * 3); // Half the size of the float buffer
+        pool.parallelForTiles(width, height, tileSize, tileSize, [&](int startX, int startY, int endX, int endY) {
+            applyGaussianHorizontalPassFixed(image, weights, fixedHorizontal, startX, startY, endX, endY);
+        });
+        pool.parallelForTiles(width, height, tileSize, tileSize, [&](int startX, int startY, int endX, int endY) {
+            applyGaussianVerticalPassFixed(fixedHorizontal, weights, blurredImage, startX, startY, endX, endY);
+        });
+        return blurredImage;
     }
 
-    // Wait for all threads to complete their work
-    for (auto& t : threads) {
-        t.join();
+    pool.parallelForTiles(width, height, tileSize, tileSize, [&](int startX, int startY, int endX, int endY) {
+        applyGaussianHorizontalPass(image, kernel, horizontal, startX, startY, endX, endY);
+    });
+    pool.parallelForTiles(width, height, tileSize, tileSize, [&](int startX, int startY, int endX, int endY) {
+        applyGaussianVerticalPass(horizontal, kernel, blurredImage, startX, startY, endX, endY);
+    });
+
+    return blurredImage;
+}
+
+// Fixed point horizontal Gaussian pass over a tile (Q14 weights, results kept with GaussianIntermediateBits fraction bits)
+void applyGaussianHorizontalPassFixed(const Image& image, const std::vector<int16_t>& weights, std::vector<int16_t>& horizontal, int startX, int startY, int endX, int endY) {
+    int width = image.width(), kernelSize = static_cast<int>(weights.size()), halfSize = kernelSize / 2;
+    int tileValues = (endX - startX) * 3;
+    const RowKernels& kernels = rowKernels();
+
+    // Same zero padded layout as the floating point pass
+    int spanStart = std::max(startX - halfSize, 0), spanEnd = std::min(endX + halfSize, width);
+    std::vector<int16_t> padded(static_cast<size_t>(endX - startX + 2 * halfSize) * 3, 0);
+    int16_t* spanDestination = padded.data() + (spanStart - (startX - halfSize)) * 3;
+    std::vector<int32_t> totals(tileValues);
+
+    for (int y = startY; y < endY; ++y) {
+        kernels.widenInt16(spanDestination, reinterpret_cast<const uint8_t*>(image.row(y) + spanStart), (spanEnd - spanStart) * 3);
+        std::fill(totals.begin(), totals.end(), 0);
+        for (int k = 0; k < kernelSize; ++k) {
+            kernels.multiplyAddInt16(totals.data(), padded.data() + k * 3, weights[k], tileValues); // At most 255 << 14
+        }
+        kernels.roundInt16(horizontal.data() + (static_cast<size_t>(y) * width + startX) * 3, totals.data(), FixedPointBits - GaussianIntermediateBits, tileValues);
     }
+}
 
-    return blurredImage; // Return the blurred image
+// Fixed point vertical Gaussian pass over a tile of the fixed point horizontal pass result
+void applyGaussianVerticalPassFixed(const std::vector<int16_t>& horizontal, const std::vector<int16_t>& weights, Image& blurredImage, int startX, int startY, int endX, int endY) {
+    int width = blurredImage.width(), height = blurredImage.height(), halfSize = static_cast<int>(weights.size()) / 2;
+    int tileValues = (endX - startX) * 3;
+    const RowKernels& kernels = rowKernels();
+    std::vector<int32_t> totals(tileValues);
+
+    for (int y = startY; y < endY; ++y) {
+        std::fill(totals.begin(), totals.end(), 0);
+        int kyStart = std::max(-halfSize, -y), kyEnd = std::min(halfSize, height - 1 - y);
+        for (int ky = kyStart; ky <= kyEnd; ++ky) {
+            const int16_t* source = horizontal.data() + (static_cast<size_t>(y + ky) * width + startX) * 3;
+            kernels.multiplyAddInt16(totals.data(), source, weights[ky + halfSize], tileValues); // At most 255 << 20
+        }
+        // Truncate like the floating point pass
+        kernels.narrowFixed(reinterpret_cast<uint8_t*>(blurredImage.row(y) + startX), totals.data(), FixedPointBits + GaussianIntermediateBits, tileValues);
+    }
 }
 
-// Function to apply box blur to a specific strip of the image
-void applyBoxBlurToStrip(const std::vector<std::vector<RGB>>& image, std::vector<std::vector<RGB>>& blurredImage, int boxSize, int startY, int endY) {
+// Function to apply box blur to a specific strip of the image from the horizontal row sums
+void applyBoxBlurToStrip(const std::vector<uint32_t>& rowSums, Image& blurredImage, int boxSize, int startY, int endY) {
     // Determine the dimensions of the image
-    int height = image.size(), width = image[0].size();
+    int height = blurredImage.height(), width = blurredImage.width();
     // Calculate half the box size to define the blur area around each pixel
     int halfBoxSize = boxSize / 2;
+    // Running vertical sums of the row sums for each column and channel
+    std::vector<uint32_t> totals(static_cast<size_t>(width) * 3, 0);
+    const RowKernels& kernels = rowKernels();
+
+    // Rows [top, bottom] of the window centred on startY; the strip primes its own window so strips need no handoff
+    int top = std::max(startY - halfBoxSize, 0), bottom = std::min(startY + halfBoxSize, height - 1);
+    for (int y = top; y <= bottom; ++y) {
+        kernels.add(totals.data(), rowSums.data() + static_cast<size_t>(y) * width * 3, width * 3);
+    }
 
     // Loop over each row in the assigned strip of the image
     for (int y = startY; y < endY; ++y) {
-        // Loop over each column in the image
+        int rowCount = std::min(y + halfBoxSize, height - 1) - std::max(y - halfBoxSize, 0) + 1; // Rows of the box inside the image
+        RGB* destination = blurredImage.row(y);
+
         for (int x = 0; x < width; ++x) {
-            // Initialize accumulators and a counter for averaging
-            int count = 0;
-            double totalRed = 0, totalGreen = 0, totalBlue = 0;
-
-            // Loop over the box centered at the current pixel
-            for (int dy = -halfBoxSize; dy <= halfBoxSize; ++dy) {
-                for (int dx = -halfBoxSize; dx <= halfBoxSize; ++dx) {
-                    // Calculate the coordinates of the neighboring pixel
-                    int newY = y + dy, newX = x + dx;
-
-                    // Check if the neighboring pixel is within image bounds
-                    if (newX >= 0 && newX < width && newY >= 0 && newY < height) {
-                        // Access the neighboring pixel
-                        const auto& pixel = image[newY][newX];
-                        // Accumulate the color values
-                        totalRed += pixel.red;
-                        totalGreen += pixel.green;
-                        totalBlue += pixel.blue;
-                        // Increment the count of pixels considered
-                        ++count;
-                    }
-                }
-            }
+            // The box is clipped to the image, so the number of pixels averaged is the product of the clipped extents
+            int columnCount = std::min(x + halfBoxSize, width - 1) - std::max(x - halfBoxSize, 0) + 1;
+            uint32_t count = static_cast<uint32_t>(rowCount * columnCount);
+            destination[x].red = static_cast<uint8_t>(totals[x * 3] / count);
+            destination[x].green = static_cast<uint8_t>(totals[x * 3 + 1] / count);
+            destination[x].blue = static_cast<uint8_t>(totals[x * 3 + 2] / count);
+        }
 
-            // Compute the average color value and assign it to the blurred image
-            // Clamp the results to ensure they are within the valid color range
-            blurredImage[y][x].red = std::clamp(static_cast<int>(totalRed / count), 0, 255);
-            blurredImage[y][x].green = std::clamp(static_cast<int>(totalGreen / count), 0, 255);
-            blurredImage[y][x].blue = std::clamp(static_cast<int>(totalBlue / count), 0, 255);
+        // Slide the window one row down
+        int entering = y + halfBoxSize + 1, leaving = y - halfBoxSize;
+        if (entering < height) {
+            kernels.add(totals.data(), rowSums.data() + static_cast<size_t>(entering) * width * 3, width * 3);
+        }
+        if (leaving >= 0) {
+            kernels.subtract(totals.data(), rowSums.data() + static_cast<size_t>(leaving) * width * 3, width * 3);
         }
     }
 }
 
 // Apply box blur to the image using multiple threads
-std::vector<std::vector<RGB>> applyBoxBlurMultipleThreads(const std::vector<std::vector<RGB>>& image, int boxSize) {
-    // Determine the number of threads to use
-    const unsigned int numThreads = std::thread::hardware_concurrency();
+Image applyBoxBlurMultipleThreads(const Image& image, int boxSize) {
     // Determine the dimensions of the image
-    int height = image.size();
-    int width = image[0].size();
+    int height = image.height();
+    int width = image.width();
     // Prepare the output image with the same dimensions
-    std::vector<std::vector<RGB>> blurredImage(height, std::vector<RGB>(width));
-
-    // Container for the worker threads
-    std::vector<std::thread> workers;
-    // Calculate the height of each strip to be processed by a thread
-    int stripHeight = height / numThreads;
-
-    // Launch one thread per strip
-    for (int i = 0; i < numThreads; ++i) {
-        // Determine the start and end rows for the current thread
-        int startY = i * stripHeight;
-        int endY = (i + 1 == numThreads) ? height : (i + 1) * stripHeight; // Ensure the last thread covers the remainder
-
-        // Launch the thread to apply box blur to its assigned strip
-        workers.emplace_back(applyBoxBlurToStrip, std::cref(image), std::ref(blurredImage), boxSize, startY, endY);
-    }
-
-    // Wait for all threads to complete
-    for (auto& worker : workers) {
-        worker.join();
-    }
+    Image blurredImage(width, height);
+    // Horizontal window sums of every row
+    std::vector<uint32_t> rowSums(static_cast<size_t>(width) * height * 3);
+
+    // Running sums slide across whole rows, so schedule full width bands (at least a box tall so priming a band's window stays cheap)
+    ThreadPool& pool = ThreadPool::instance();
+    int bandHeight = std::max(tileSize, boxSize);
+
+    // Run one pass and wait before the next (the vertical pass reads row sums from neighbouring bands)
+    pool.parallelForTiles(width, height, width, bandHeight, [&](int, int startY, int, int endY) {
+        computeBoxBlurRowSums(image, boxSize, rowSums, startY, endY);
+    });
+    pool.parallelForTiles(width, height, width, bandHeight, [&](int, int startY, int, int endY) {
+        applyBoxBlurToStrip(rowSums, blurredImage, boxSize, startY, endY);
+    });
 
     // Return the blurred image
     return blurredImage;
 }
 
-// Apply motion blur to the image based on a given motion length with multiple threads
-void applyMotionBlurSegment(const std::vector<std::vector<RGB>>& image, std::vector<std::vector<RGB>>& blurredImage, int startY, int endY, int motionLength) {
-    int width = image[0].size(); // The width of the image
+// Apply motion blur along lines [startLine, endLine) of the path with running sums (one add and one subtract per pixel)
+void applyMotionBlurSegment(const Image& image, Image& blurredImage, const MotionPath& path, int startLine, int endLine, int motionLength) {
+    int width = image.width(), height = image.height(); // The dimensions of the image
     int halfLength = motionLength / 2; // Half the motion length to average pixels around the target pixel
+    const std::vector<int>& offsets = path.offsets;
+
+    if (path.xMajor) {
+        // Walk each line on its own, the line only advances along rows so the reads stay mostly sequential
+        for (int line = startLine; line < endLine; ++line) {
+            // Column range [first, last) where the line is inside the image (offsets never decrease, so it is contiguous)
+            int first = std::lower_bound(offsets.begin(), offsets.end(), -line) - offsets.begin();
+            int last = std::lower_bound(offsets.begin(), offsets.end(), height - line) - offsets.begin();
+            auto rowOf = [&](int x) { int minor = line + offsets[x]; return path.mirrored ? height - 1 - minor : minor; };
+
+            // Prime the window of the first column (only the far half is inside the image)
+            uint32_t totalRed = 0, totalGreen = 0, totalBlue = 0;
+            for (int x = first; x <= std::min(first + halfLength, last - 1); ++x) {
+                const RGB& pixel = image[rowOf(x)][x];
+                totalRed += pixel.red;
+                totalGreen += pixel.green;
+                totalBlue += pixel.blue;
+            }
 
-    // Loop through each pixel in the segment
-    for (int y = startY; y < endY; ++y) {
-        for (int x = 0; x < width; ++x) {
-            double totalRed = 0, totalGreen = 0, totalBlue = 0; // Accumulators for color values
-            int count = 0; // Number of pixels considered in the blur calculation
-
-            // Average pixels in the motion direction (horizontal)
-            for (int mx = -halfLength; mx <= halfLength; ++mx) {
-                int currentX = x + mx; // Calculate the x-coordinate of the pixel to consider
-                // Ensure the pixel is within image bounds
-                if (currentX >= 0 && currentX < width) {
-                    const RGB& pixel = image[y][currentX]; // Get the pixel
-                    // Accumulate the color values
+            for (int x = first; x < last; ++x) {
+                // Average the pixels of the window that lie inside the image
+                uint32_t count = std::min(x + halfLength, last - 1) - std::max(x - halfLength, first) + 1;
+                RGB& output = blurredImage[rowOf(x)][x];
+                output.red = static_cast<uint8_t>(totalRed / count);
+                output.green = static_cast<uint8_t>(totalGreen / count);
+                output.blue = static_cast<uint8_t>(totalBlue / count);
+
+                // Slide the window one step along the line
+                int entering = x + halfLength + 1, leaving = x - halfLength;
+                if (entering < last) {
+                    const RGB& pixel = image[rowOf(entering)][entering];
                     totalRed += pixel.red;
                     totalGreen += pixel.green;
                     totalBlue += pixel.blue;
-                    count++; // Increment the count
+                }
+                if (leaving >= first) {
+                    const RGB& pixel = image[rowOf(leaving)][leaving];
+                    totalRed -= pixel.red;
+                    totalGreen -= pixel.green;
+                    totalBlue -= pixel.blue;
                 }
             }
-
-            // Calculate and set the average color value for the target pixel
-            blurredImage[y][x].red = std::clamp(static_cast<int>(totalRed / count), 0, 255);
-            blurredImage[y][x].green = std::clamp(static_cast<int>(totalGreen / count), 0, 255);
-            blurredImage[y][x].blue = std::clamp(static_cast<int>(totalBlue / count), 0, 255);
         }
+        return;
     }
-}
 
-// Apply motion blur to the image based on a given motion length with multiple threads
-std::vector<std::vector<RGB>> applyMotionBlurMultipleThreads(const std::vector<std::vector<RGB>>& image, int motionLength) {
-    // Determine the optimal number of threads based to use
-    const unsigned int numThreads = std::thread::hardware_concurrency();
-    int height = image.size(), width = image[0].size(); // Dimensions of the input image
-    std::vector<std::vector<RGB>> blurredImage(height, std::vector<RGB>(width)); // Prepare the output image
+    // Steep lines advance one row per step, so sweep the rows once and move every line of the segment together (reads stay along rows)
+    std::vector<uint32_t> totals(static_cast<size_t>(endLine - startLine) * 3, 0), counts(endLine - startLine, 0);
 
-    std::vector<std::thread> threads; // Container for threads
-    int segmentHeight = height / numThreads; // Calculate the height of each segment
+    // Visit the lines of the segment that cross row y, along with the column they cross it at
+    auto forEachLine = [&](int y, auto&& visit) {
+        int lineStart = std::max(startLine, -offsets[y]), lineEnd = std::min(endLine, width - offsets[y]);
+        for (int line = lineStart; line < lineEnd; ++line) {
+            int minor = line + offsets[y];
+            visit(line - startLine, path.mirrored ? width - 1 - minor : minor);
+        }
+    };
 
-    // Create and start threads, each processing a segment of the image
-    for (unsigned int i = 0; i < numThreads; ++i) {
-        int startY = i * segmentHeight; // Start Y-coordinate for this thread
-        int endY = (i == numThreads - 1) ? height : (i + 1) * segmentHeight; // End Y-coordinate for this thread
-        threads.emplace_back(applyMotionBlurSegment, std::cref(image), std::ref(blurredImage), startY, endY, motionLength);
+    for (int y = -halfLength; y < height; ++y) {
+        // Rows entering the window on the far side
+        int entering = y + halfLength;
+        if (entering < height) {
+            const RGB* source = image.row(entering);
+            forEachLine(entering, [&](int index, int x) {
+                totals[index * 3] += source[x].red;
+                totals[index * 3 + 1] += source[x].green;
+                totals[index * 3 + 2] += source[x].blue;
+                ++counts[index];
+            });
+        }
+        if (y < 0) continue;
+
+        // Average the window of every line crossing this row
+        RGB* destination = blurredImage.row(y);
+        forEachLine(y, [&](int index, int x) {
+            destination[x].red = static_cast<uint8_t>(totals[index * 3] / counts[index]);
+            destination[x].green = static_cast<uint8_t>(totals[index * 3 + 1] / counts[index]);
+            destination[x].blue = static_cast<uint8_t>(totals[index * 3 + 2] / counts[index]);
+        });
+
+        // Rows leaving the window on the near side
+        int leaving = y - halfLength;
+        if (leaving >= 0) {
+            const RGB* source = image.row(leaving);
+            forEachLine(leaving, [&](int index, int x) {
+                totals[index * 3] -= source[x].red;
+                totals[index * 3 + 1] -= source[x].green;
+                totals[index * 3 + 2] -= source[x].blue;
+                --counts[index];
+            });
+        }
     }
+}
 
-    // Wait for all threads to complete
-    for (auto& t : threads) {
-        t.join();
-    }
+// Apply motion blur to the image based on a given motion length and angle with multiple threads
+Image applyMotionBlurMultipleThreads(const Image& image, int motionLength, double angle) {
+    int height = image.height(), width = image.width(); // Dimensions of the input image
+    Image blurredImage(width, height); // Prepare the output image
+    MotionPath path = planMotionPath(width, height, angle); // Lines the blur averages along
+
+    // Schedule groups of neighbouring lines as tiles (each pixel lies on exactly one line, so threads never share pixels)
+    ThreadPool::instance().parallelForTiles(path.endLine - path.firstLine, 1, tileSize, 1, [&](int begin, int, int end, int) {
+        applyMotionBlurSegment(image, blurredImage, path, path.firstLine + begin, path.firstLine + end, motionLength);
+    });
 
     return blurredImage; // Return the processed image
 }
@@ -1169,50 +4503,206 @@ double colorDistanceMultipleThreads(const RGB& color1, const RGB& color2) {
     );
 }
 
-// Apply bucket fill to the other image with multiple threads
-std::vector<std::vector<RGB>> applyBucketFillMultipleThreads(const std::vector<std::vector<RGB>>& image, int threshold) {
-    int height = image.size(), width = image[0].size(); // Dimensions of the image
+// Check whether a color is within the Euclidean threshold of the target color (compares squared distances, no sqrt)
+bool withinColorThreshold(const RGB& color, const RGB& target, int threshold) {
+    int red = color.red - target.red, green = color.green - target.green, blue = color.blue - target.blue;
+    int limit = std::min(threshold, MaxColorDistance); // Every color is within MaxColorDistance, and the square cannot overflow
+    return threshold >= 0 && red * red + green * green + blue * blue <= limit * limit; // Same decision as colorDistance <= threshold
+}
+
+// Apply bucket fill to the other image with multiple threads (level synchronous span fill over an atomic bitmap)
+Image applyBucketFillMultipleThreads(const Image& image, int threshold) {
+    int height = image.height(), width = image.width(); // Dimensions of the image
     const RGB fillColor = {0, 255, 0}; // Define fill color as green
-    std::vector<std::vector<RGB>> bucketFilledImage = image; // Copy of the original image to apply the fill
-    std::vector<std::vector<bool>> visited(height, std::vector<bool>(width, false)); // Keep track of visited pixels
-    
-    // Lambda function to fill starting from a point with offset applied to the seed point - allows starting the fill from different directions
-    auto fillFunc = [&](int offsetX, int offsetY) {
-        std::stack<std::pair<int, int>> stack; // Use a stack for depth-first search (DFS)
-        stack.push({bucketFillX + offsetX, bucketFillY + offsetY}); // Starting point with offset
-
-        while (!stack.empty()) {
-            auto [x, y] = stack.top(); // Current position
-            stack.pop();
-
-            // Check bounds and visited status
-            if (x < 0 || x >= width || y < 0 || y >= height || visited[y][x]) continue;
-
-            // Check if current pixel is within the color threshold
-            if (colorDistanceMultipleThreads(image[y][x], image[bucketFillY][bucketFillX]) <= threshold) {
-                bucketFilledImage[y][x] = fillColor; // Apply fill color
-                visited[y][x] = true; // Mark as visited
-
-                // Add neighboring pixels to stack for further processing
-                stack.push({x + 1, y});
-                stack.push({x - 1, y});
-                stack.push({x, y + 1});
-                stack.push({x, y - 1});
+    Image bucketFilledImage = image; // Copy of the original image to apply the fill
+
+    // Check if seed point is within the image
+    if (bucketFillX < 0 || bucketFillX >= width || bucketFillY < 0 || bucketFillY >= height) {
+        std::cerr << "Seed point is outside the image bounds." << std::endl << std::endl;
+        return bucketFilledImage; // Return the original image if seed point is invalid
+    }
+
+    const RGB targetColor = image[bucketFillY][bucketFillX];
+    std::vector<std::atomic<uint64_t>> filled((static_cast<size_t>(width) * height + 63) / 64); // One bit per pixel, set by the thread that claims it
+
+    auto similar = [&](int x, int y) { return withinColorThreshold(image[y][x], targetColor, threshold); };
+    auto isFilled = [&](int x, int y) {
+        size_t index = static_cast<size_t>(y) * width + x;
+        return (filled[index >> 6].load(std::memory_order_relaxed) >> (index & 63)) & 1;
+    };
+    // Atomically set the pixel's bit, true only for the one thread that set it first
+    auto claim = [&](int x, int y) {
+        size_t index = static_cast<size_t>(y) * width + x;
+        uint64_t bit = uint64_t(1) << (index & 63);
+        return (filled[index >> 6].fetch_or(bit, std::memory_order_relaxed) & bit) == 0;
+    };
+
+    // Claim the horizontal run of similar pixels through (x, y), paint it and queue one pixel per unfilled similar run in the rows above and below
+    // Runs stop at pixels another thread already claimed, that thread grows its own run past them, so the filled region is the same whatever the order
+    auto fillSpan = [&](int x, int y, std::vector<std::pair<int, int>>& next) {
+        if (!similar(x, y) || !claim(x, y)) return;
+        int left = x, right = x;
+        while (left > 0 && similar(left - 1, y) && claim(left - 1, y)) --left;
+        while (right < width - 1 && similar(right + 1, y) && claim(right + 1, y)) ++right;
+        std::fill(bucketFilledImage.row(y) + left, bucketFilledImage.row(y) + right + 1, fillColor);
+
+        for (int neighborY : {y - 1, y + 1}) {
+            if (neighborY < 0 || neighborY >= height) continue;
+            bool inRun = false;
+            for (int neighborX = left; neighborX <= right; ++neighborX) {
+                bool open = similar(neighborX, neighborY) && !isFilled(neighborX, neighborY);
+                if (open && !inRun) next.push_back({neighborX, neighborY});
+                inRun = open;
+            }
+        }
+    };
+
+    // Expand the fill one frontier of runs at a time, small frontiers are not worth waking the pool for
+    constexpr size_t minParallelFrontier = 64;
+    std::vector<std::pair<int, int>> frontier = {{bucketFillX, bucketFillY}}, next;
+    std::mutex nextMutex; // Guards next while chunks merge their local results
+    while (!frontier.empty()) {
+        next.clear();
+        auto expandFrontier = [&](int begin, int end) {
+            std::vector<std::pair<int, int>> localNext;
+            for (int i = begin; i < end; ++i) {
+                fillSpan(frontier[i].first, frontier[i].second, localNext);
             }
+            std::lock_guard<std::mutex> lock(nextMutex);
+            next.insert(next.end(), localNext.begin(), localNext.end());
+        };
+
+        if (frontier.size() < minParallelFrontier) {
+            expandFrontier(0, static_cast<int>(frontier.size()));
+        } else {
+            ThreadPool::instance().parallelFor(static_cast<int>(frontier.size()), expandFrontier);
+        }
+        frontier.swap(next);
+    }
+
+    return bucketFilledImage; // Return the image after bucket fill
+}
+
+// Label the 4-connected regions of pixels within the threshold of the target color with a banded parallel union-find
+std::vector<int32_t> labelColorRegions(const Image& image, const RGB& target, int threshold) {
+    TraceSpan span("region labels");
+    int height = image.height(), width = image.width();
+    std::vector<int32_t> parent(static_cast<size_t>(width) * height);
+
+    // Roots are always the smallest index of their tree, so parent[i] <= i everywhere
+    auto find = [&](int32_t i) {
+        while (parent[i] != i) {
+            parent[i] = parent[parent[i]]; // Path halving
+            i = parent[i];
         }
+        return i;
+    };
+    auto unite = [&](int32_t a, int32_t b) {
+        a = find(a);
+        b = find(b);
+        if (a != b) parent[std::max(a, b)] = std::min(a, b);
     };
 
-    // Create threads for each direction of fill operation starting from the seed point
-    std::thread tAbove(fillFunc, 0, -1); // Thread for filling upwards
-    std::thread tLeft(fillFunc, -1, 0); // Thread for filling leftwards
-    std::thread tRight(fillFunc, 1, 0); // Thread for filling rightwards
-    std::thread tDown(fillFunc, 0, 1); // Thread for filling downwards
+    // Every thread links the pixels of its own band of rows, trees never leave a band so no locking is needed
+    ThreadPool& pool = ThreadPool::instance();
+    int bands = static_cast<int>(std::min<unsigned int>(pool.size(), static_cast<unsigned int>(height)));
+    auto bandStart = [&](int band) { return static_cast<int>(static_cast<long long>(height) * band / bands); };
+    pool.parallelFor(bands, [&](int begin, int end) {
+        for (int band = begin; band < end; ++band) {
+            for (int y = bandStart(band); y < bandStart(band + 1); ++y) {
+                const RGB* row = image.row(y);
+                int32_t rowIndex = static_cast<int32_t>(y * width);
+                for (int x = 0; x < width; ++x) {
+                    int32_t i = rowIndex + x;
+                    if (!withinColorThreshold(row[x], target, threshold)) {
+                        parent[i] = -1;
+                        continue;
+                    }
+                    parent[i] = i;
+                    if (x > 0 && parent[i - 1] >= 0) unite(i - 1, i);
+                    if (y > bandStart(band) && parent[i - width] >= 0) unite(i - width, i);
+                }
+            }
+        }
+    });
+
+    // Stitch the bands together along their first rows
+    for (int band = 1; band < bands; ++band) {
+        int32_t rowIndex = static_cast<int32_t>(bandStart(band) * width);
+        for (int x = 0; x < width; ++x) {
+            int32_t i = rowIndex + x;
+            if (parent[i] >= 0 && parent[i - width] >= 0) unite(i - width, i);
+        }
+    }
+
+    // Point every pixel straight at its root (parent[i] <= i, so walking forward each parent is already final)
+    for (size_t i = 0; i < parent.size(); ++i) {
+        if (parent[i] >= 0) parent[i] = parent[parent[i]];
+    }
+
+    return parent;
+}
+
+// Look up (or compute and cache) the region labels of the image for a threshold and target color
+std::shared_ptr<const std::vector<int32_t>> regionLabelsFor(const Image& image, const RGB& target, int threshold) {
+    static std::mutex cacheMutex;
+    static std::vector<RegionLabels> cache; // Least recently used first
+    std::lock_guard<std::mutex> lock(cacheMutex);
+
+    // Drop the labels of images that no longer exist
+    cache.erase(std::remove_if(cache.begin(), cache.end(), [](const RegionLabels& entry) { return entry.buffer.expired(); }), cache.end());
+
+    auto sameColor = [](const RGB& a, const RGB& b) { return a.red == b.red && a.green == b.green && a.blue == b.blue; };
+    for (auto entry = cache.begin(); entry != cache.end(); ++entry) {
+        if (entry->buffer.lock() == image.buffer() && entry->firstRow == image.row(0) && entry->width == image.width() &&
+            entry->height == image.height() && entry->threshold == threshold && sameColor(entry->target, target)) {
+            RegionLabels hit = std::move(*entry);
+            cache.erase(entry);
+            cache.push_back(std::move(hit));
+            return cache.back().labels;
+        }
+    }
+
+    auto labels = std::make_shared<const std::vector<int32_t>>(labelColorRegions(image, target, threshold));
+    if (cache.size() >= MaxCachedRegionLabels) cache.erase(cache.begin());
+    cache.push_back({image.buffer(), image.row(0), image.width(), image.height(), threshold, target, labels});
+    return labels;
+}
 
-    // Wait for all threads to complete their execution
-    tAbove.join();
-    tLeft.join();
-    tRight.join();
-    tDown.join();
+// Apply bucket fill from every seed at once using the cached region labels (a label lookup per seed and one masked pass over the image)
+Image applyBucketFillIndexed(const Image& image, int threshold, const std::vector<std::pair<int, int>>& seeds) {
+    int height = image.height(), width = image.width(); // Dimensions of the image
+    const RGB fillColor = {0, 255, 0}; // Define fill color as green
+    Image bucketFilledImage = image; // Copy of the original image to apply the fill
+
+    // Resolve every seed to the label map of its color and its region in it (seeds sharing a region collapse into one)
+    std::vector<std::pair<std::shared_ptr<const std::vector<int32_t>>, int32_t>> regions;
+    for (const auto& [seedX, seedY] : seeds) {
+        if (seedX < 0 || seedX >= width || seedY < 0 || seedY >= height) {
+            std::cerr << "Seed point is outside the image bounds." << std::endl << std::endl;
+            continue; // Skip invalid seeds, the others still fill
+        }
+        auto labels = regionLabelsFor(image, image[seedY][seedX], threshold);
+        int32_t label = (*labels)[static_cast<size_t>(seedY) * width + seedX];
+        if (label < 0) continue; // Only possible with a negative threshold
+        auto same = [&](const auto& region) { return region.first == labels && region.second == label; };
+        if (std::none_of(regions.begin(), regions.end(), same)) regions.push_back({labels, label});
+    }
+    if (regions.empty()) return bucketFilledImage;
+
+    // Paint every pixel whose label matches one of the seeds' regions
+    ThreadPool::instance().parallelForTiles(width, height, width, tileSize, [&](int startX, int startY, int endX, int endY) {
+        for (int y = startY; y < endY; ++y) {
+            RGB* row = bucketFilledImage.row(y);
+            size_t rowIndex = static_cast<size_t>(y) * width;
+            for (const auto& [labels, label] : regions) {
+                const int32_t* rowLabels = labels->data() + rowIndex;
+                for (int x = startX; x < endX; ++x) {
+                    if (rowLabels[x] == label) row[x] = fillColor;
+                }
+            }
+        }
+    });
 
     return bucketFilledImage; // Return the image after bucket fill
 }
@@ -1226,24 +4716,24 @@ double cubicInterpolateMultipleThreads(double p[4], double x) {
 // Function to perform bicubic interpolation on a 4x4 patch of an image with multiple threads (same as single)
 double bicubicInterpolateMultipleThreads(double arr[4][4], double x, double y) {
     double colArr[4];
-    // Interpolates the values along the y-axis
+    // Interpolates each row (arr[row][column]) along the x-axis
     for (int i = 0; i < 4; i++) {
-        colArr[i] = cubicInterpolateSingleThread(arr[i], y);
+        colArr[i] = cubicInterpolateSingleThread(arr[i], x);
     }
-    // Interpolates the result along the x-axis
-    return cubicInterpolateSingleThread(colArr, x);
+    // Interpolates the results along the y-axis
+    return cubicInterpolateSingleThread(colArr, y);
 }
 
 // Function to process a segment of the image for resizing, running in a separate thread
-void processSegmentMultipleThreads(const std::vector<std::vector<RGB>>& image, std::vector<std::vector<RGB>>& resized, int startRow, int endRow, int newWidth, double xRatio, double yRatio) {
+void processSegmentMultipleThreads(const Image& image, Image& resized, int startCol, int startRow, int endCol, int endRow, double xRatio, double yRatio) {
     // Determine the original image's width and height
-    int imgWidth = image[0].size();
-    int imgHeight = image.size();
+    int imgWidth = image.width();
+    int imgHeight = image.height();
 
     // Iterate over each row in the segment
     for (int i = startRow; i < endRow; ++i) {
-        // Iterate over each column in the new, resized image
-        for (int j = 0; j < newWidth; ++j) {
+        // Iterate over each column of the segment in the new, resized image
+        for (int j = startCol; j < endCol; ++j) {
             // Calculate the corresponding x and y coordinates in the original image
             double x = (j + 0.5) * xRatio - 0.5;
             double y = (i + 0.5) * yRatio - 0.5;
@@ -1283,43 +4773,97 @@ void processSegmentMultipleThreads(const std::vector<std::vector<RGB>>& image, s
 }
 
 // Function to resize an image using bicubic interpolation with multiple threads
-std::vector<std::vector<RGB>> resizeBicubicMultipleThreads(const std::vector<std::vector<RGB>>& image, int newWidth, int newHeight) {
+Image resizeBicubicMultipleThreads(const Image& image, int newWidth, int newHeight) {
     // Determine the height of the original image
-    int imgHeight = image.size();
+    int imgHeight = image.height();
     // Create a resized image placeholder with the desired dimensions
-    std::vector<std::vector<RGB>> resized(newHeight, std::vector<RGB>(newWidth));
+    Image resized(newWidth, newHeight);
     // Calculate the ratios between the new and old dimensions
-    double xRatio = static_cast<double>(image[0].size()) / newWidth;
+    double xRatio = static_cast<double>(image.width()) / newWidth;
     double yRatio = static_cast<double>(imgHeight) / newHeight;
 
-    // Determine the number of threads to use
-    const int numThreads = std::thread::hardware_concurrency();
-    std::vector<std::thread> threads(numThreads);
+    // Schedule the output tiles on the pool threads and wait for all of them to complete their work
+    ThreadPool::instance().parallelForTiles(newWidth, newHeight, tileSize, tileSize, [&](int startCol, int startRow, int endCol, int endRow) {
+        if (fixedPoint) {
+            processSegmentFixed(image, resized, startCol, startRow, endCol, endRow, xRatio, yRatio);
+        } else {
+            processSegmentMultipleThreads(image, resized, startCol, startRow, endCol, endRow, xRatio, yRatio);
+        }
+    });
+
+    return resized;
+}
 
-    // Calculate the number of rows each thread should process
-    int rowsPerThread = newHeight / numThreads;
-    for (int i = 0; i < numThreads; ++i) {
-        // Calculate the start and end row for each thread
-        int startRow = i * rowsPerThread;
-        int endRow = (i == (numThreads - 1) ? newHeight : startRow + rowsPerThread); // Ensure the last thread covers the remainder
-        // Launch the thread to process its segment of the image
-        threads[i] = std::thread(processSegmentMultipleThreads, std::cref(image), std::ref(resized), startRow, endRow, newWidth, xRatio, yRatio);
-    }
+// Fixed point version of processSegmentMultipleThreads (Q14 Catmull-Rom weights, integer accumulators)
+void processSegmentFixed(const Image& image, Image& resized, int startCol, int startRow, int endCol, int endRow, double xRatio, double yRatio) {
+    int imgWidth = image.width(), imgHeight = image.height();
+
+    // Catmull-Rom weights of the four taps for a fractional offset t (the same polynomial cubicInterpolate evaluates)
+    auto cubicWeights = [](double t, int16_t* quantized) {
+        double weights[4] = {
+            0.5 * (-t + 2 * t * t - t * t * t),
+            0.5 * (2 - 5 * t * t + 3 * t * t * t),
+            0.5 * (t + 4 * t * t - 3 * t * t * t),
+            0.5 * (-t * t + t * t * t)
+        };
+        quantizeWeights(weights, quantized, 4);
+    };
 
-    // Wait for all threads to complete their work
-    for (auto& t : threads) {
-        t.join();
+    // Weights and clamped taps only depend on the column (or the row), so work them out once per tile
+    int tileWidth = endCol - startCol;
+    std::vector<int16_t> columnWeights(static_cast<size_t>(tileWidth) * 4);
+    std::vector<int> columnTaps(static_cast<size_t>(tileWidth) * 4);
+    for (int j = startCol; j < endCol; ++j) {
+        double x = (j + 0.5) * xRatio - 0.5;
+        int xInt = int(x);
+        cubicWeights(x - xInt, &columnWeights[(j - startCol) * 4]);
+        for (int n = -1; n <= 2; ++n) {
+            columnTaps[(j - startCol) * 4 + n + 1] = std::clamp(xInt + n, 0, imgWidth - 1);
+        }
     }
 
-    return resized;
+    for (int i = startRow; i < endRow; ++i) {
+        double y = (i + 0.5) * yRatio - 0.5;
+        int yInt = int(y);
+        int16_t rowWeights[4];
+        cubicWeights(y - yInt, rowWeights);
+        const RGB* rows[4];
+        for (int m = -1; m <= 2; ++m) {
+            rows[m + 1] = image.row(std::clamp(yInt + m, 0, imgHeight - 1));
+        }
+
+        for (int j = startCol; j < endCol; ++j) {
+            const int16_t* xWeights = &columnWeights[(j - startCol) * 4];
+            const int* taps = &columnTaps[(j - startCol) * 4];
+            // Like bicubicInterpolate, the first step runs along each row with the x offset and the second across the rows with the y offset
+            int32_t red = 0, green = 0, blue = 0;
+            for (int m = 0; m < 4; ++m) {
+                int32_t rowRed = 0, rowGreen = 0, rowBlue = 0;
+                for (int n = 0; n < 4; ++n) {
+                    const RGB& pixel = rows[m][taps[n]];
+                    rowRed += pixel.red * xWeights[n];
+                    rowGreen += pixel.green * xWeights[n];
+                    rowBlue += pixel.blue * xWeights[n];
+                }
+                int32_t half = 1 << (FixedPointBits - ResizeIntermediateBits - 1);
+                red += ((rowRed + half) >> (FixedPointBits - ResizeIntermediateBits)) * rowWeights[m];
+                green += ((rowGreen + half) >> (FixedPointBits - ResizeIntermediateBits)) * rowWeights[m];
+                blue += ((rowBlue + half) >> (FixedPointBits - ResizeIntermediateBits)) * rowWeights[m];
+            }
+            int shift = FixedPointBits + ResizeIntermediateBits;
+            resized[i][j].red = static_cast<uint8_t>(std::clamp(red >> shift, 0, 255));
+            resized[i][j].green = static_cast<uint8_t>(std::clamp(green >> shift, 0, 255));
+            resized[i][j].blue = static_cast<uint8_t>(std::clamp(blue >> shift, 0, 255));
+        }
+    }
 }
 
 // Thread function to resize a segment of the image
-void resizeSegmentMultipleThreads(const std::vector<std::vector<RGB>>& image, std::vector<std::vector<RGB>>& resized, double xRatio, double yRatio, int startY, int endY, int newWidth) {
+void resizeSegmentMultipleThreads(const Image& image, Image& resized, double xRatio, double yRatio, int startX, int startY, int endX, int endY) {
     // Iterate over each row in the segment
     for (int i = startY; i < endY; ++i) {
-        // Iterate over each column in the output image
-        for (int j = 0; j < newWidth; ++j) {
+        // Iterate over each column of the segment in the output image
+        for (int j = startX; j < endX; ++j) {
             // Calculate the source pixel coordinates in the original image
             int xL = std::floor(xRatio * j);
             int yL = std::floor(yRatio * i);
@@ -1332,9 +4876,9 @@ void resizeSegmentMultipleThreads(const std::vector<std::vector<RGB>>& image, st
 
             // Retrieve the four pixels surrounding the target location in the original image
             RGB a = image[yL][xL]; // Top-left
-            RGB b = xH < image[0].size() ? image[yL][xH] : a; // Top-right
-            RGB c = yH < image.size() ? image[yH][xL] : a; // Bottom-left
-            RGB d = (xH < image[0].size() && yH < image.size()) ? image[yH][xH] : a; // Bottom-right
+            RGB b = xH < image.width() ? image[yL][xH] : a; // Top-right
+            RGB c = yH < image.height() ? image[yH][xL] : a; // Bottom-left
+            RGB d = (xH < image.width() && yH < image.height()) ? image[yH][xH] : a; // Bottom-right
 
             // Perform bilinear interpolation for each color channel
             resized[i][j].red = static_cast<uint8_t>(
@@ -1357,54 +4901,85 @@ void resizeSegmentMultipleThreads(const std::vector<std::vector<RGB>>& image, st
 }
 
 // Function to resize an image using bilinear interpolation with multiple threads
-std::vector<std::vector<RGB>> resizeBilinearMultipleThreads(const std::vector<std::vector<RGB>>& image, int newWidth, int newHeight) {
-    int imgHeight = image.size();
-    int imgWidth = image[0].size();
+Image resizeBilinearMultipleThreads(const Image& image, int newWidth, int newHeight) {
+    int imgHeight = image.height();
+    int imgWidth = image.width();
 
     // Create a new image with the specified width and height
-    std::vector<std::vector<RGB>> resized(newHeight, std::vector<RGB>(newWidth));
+    Image resized(newWidth, newHeight);
     // Calculate ratios to scale the image
-    double xRatio = static_cast<double>(imgWidth - 1) / (newWidth - 1);
-    double yRatio = static_cast<double>(imgHeight - 1) / (newHeight - 1);
+    double xRatio = newWidth > 1 ? static_cast<double>(imgWidth - 1) / (newWidth - 1) : 0.0; // A single output column samples the first source column
+    double yRatio = newHeight > 1 ? static_cast<double>(imgHeight - 1) / (newHeight - 1) : 0.0;
+
+    // Process each output tile on the pool and wait for all of them to complete
+    ThreadPool::instance().parallelForTiles(newWidth, newHeight, tileSize, tileSize, [&](int startX, int startY, int endX, int endY) {
+        if (fixedPoint) {
+            resizeSegmentFixed(image, resized, xRatio, yRatio, startX, startY, endX, endY);
+        } else {
+            resizeSegmentMultipleThreads(image, resized, xRatio, yRatio, startX, startY, endX, endY);
+        }
+    });
 
-    // Determine the number of threads to use
-    const int numThreads = std::thread::hardware_concurrency();
-    std::vector<std::thread> threads(numThreads);
-    int segmentHeight = newHeight / numThreads;
+    // Return the resized image
+    return resized;
+}
 
-    // Launch threads to process each segment of the image
-    for (int i = 0; i < numThreads; ++i) {
-        int startY = i * segmentHeight;
-        int endY = (i == numThreads - 1) ? newHeight : (i + 1) * segmentHeight;
-        threads[i] = std::thread(resizeSegmentMultipleThreads, std::ref(image), std::ref(resized), xRatio, yRatio, startY, endY, newWidth);
+// Fixed point version of resizeSegmentMultipleThreads (Q14 weights, integer accumulators)
+void resizeSegmentFixed(const Image& image, Image& resized, double xRatio, double yRatio, int startX, int startY, int endX, int endY) {
+    constexpr int32_t one = 1 << FixedPointBits;
+    constexpr int firstShift = FixedPointBits - ResizeIntermediateBits, secondShift = FixedPointBits + ResizeIntermediateBits;
+
+    // Source columns and weights only depend on the output column, so work them out once per tile
+    int tileWidth = endX - startX;
+    std::vector<int> lowColumns(tileWidth), highColumns(tileWidth);
+    std::vector<int32_t> columnWeights(tileWidth);
+    for (int j = startX; j < endX; ++j) {
+        int xL = std::floor(xRatio * j), xH = std::ceil(xRatio * j);
+        lowColumns[j - startX] = xL;
+        highColumns[j - startX] = xH < image.width() ? xH : xL;
+        columnWeights[j - startX] = static_cast<int32_t>(std::lround(((xRatio * j) - xL) * one));
     }
 
-    // Wait for all threads to complete
-    for (auto& th : threads) {
-        th.join();
+    for (int i = startY; i < endY; ++i) {
+        int yL = std::floor(yRatio * i), yH = std::ceil(yRatio * i);
+        int32_t yWeight = static_cast<int32_t>(std::lround(((yRatio * i) - yL) * one));
+        const RGB* top = image.row(yL);
+        const RGB* bottom = image.row(yH < image.height() ? yH : yL);
+        RGB* destination = resized.row(i);
+
+        for (int j = startX; j < endX; ++j) {
+            int xL = lowColumns[j - startX], xH = highColumns[j - startX];
+            int32_t xWeight = columnWeights[j - startX];
+            // Lerp along x with the top and bottom rows, round to ResizeIntermediateBits, then lerp along y (truncating like the double path)
+            auto lerp = [&](uint8_t RGB::*channel) {
+                int32_t upper = (top[xL].*channel * (one - xWeight) + top[xH].*channel * xWeight + (1 << (firstShift - 1))) >> firstShift;
+                int32_t lower = (bottom[xL].*channel * (one - xWeight) + bottom[xH].*channel * xWeight + (1 << (firstShift - 1))) >> firstShift;
+                return static_cast<uint8_t>((upper * (one - yWeight) + lower * yWeight) >> secondShift);
+            };
+            destination[j].red = lerp(&RGB::red);
+            destination[j].green = lerp(&RGB::green);
+            destination[j].blue = lerp(&RGB::blue);
+        }
     }
-
-    // Return the resized image
-    return resized;
 }
 
 // Apply nearest neighbor resizing to the image with multiple threads
-std::vector<std::vector<RGB>> nearestNeighborResizeMultipleThreads(const std::vector<std::vector<RGB>>& image, int newWidth, int newHeight) {
+Image nearestNeighborResizeMultipleThreads(const Image& image, int newWidth, int newHeight) {
     // Calculate the original image dimensions
-    int imageWidth = image[0].size();
-    int imageHeight = image.size();
+    int imageWidth = image.width();
+    int imageHeight = image.height();
 
     // Calculate the scale factors for width and height
     double widthScale = static_cast<double>(newWidth) / imageWidth;
     double heightScale = static_cast<double>(newHeight) / imageHeight;
 
     // Prepare the vector to hold the resized image
-    std::vector<std::vector<RGB>> resizedImage(newHeight, std::vector<RGB>(newWidth));
+    Image resizedImage(newWidth, newHeight);
 
-    // Define a worker lambda function to process a portion of the image
-    auto worker = [&](int startX, int endX) {
-        for (int x = startX; x < endX; x++) {
-            for (int y = 0; y < newHeight; y++) {
+    // Define a worker lambda function to process one tile of the image
+    auto worker = [&](int startX, int startY, int endX, int endY) {
+        for (int y = startY; y < endY; y++) {
+            for (int x = startX; x < endX; x++) {
                 // Calculate the corresponding original coordinates
                 int originalX = static_cast<int>(std::floor(x / widthScale));
                 int originalY = static_cast<int>(std::floor(y / heightScale));
@@ -1415,23 +4990,138 @@ std::vector<std::vector<RGB>> nearestNeighborResizeMultipleThreads(const std::ve
         }
     };
 
-    // Determine the number of threads to use
-    const int numThreads = std::thread::hardware_concurrency();
-    std::vector<std::future<void>> futures; // Futures to wait for each thread to finish
-    int chunkSize = newWidth / numThreads; // Determine the chunk size for each thread
+    // Schedule the output tiles on the pool threads and block until each one completes
+    ThreadPool::instance().parallelForTiles(newWidth, newHeight, tileSize, tileSize, worker);
+
+    // Return the resized image
+    return resizedImage;
+}
+
+// Fixed point horizontal resize pass over a tile (results kept in int16 with SeparableResizeIntermediateBits fraction bits)
+void resizeHorizontalPassFixed(const Image& image, const ResizePlan& plan, std::vector<int16_t>& horizontal, int startX, int startY, int endX, int endY) {
+    int taps = plan.columns.taps, tileValues = (endX - startX) * 3;
+    const RowKernels& kernels = rowKernels();
+    std::vector<int32_t> totals(tileValues);
+
+    for (int y = startY; y < endY; ++y) {
+        const RGB* source = image.row(y);
+        for (int x = startX; x < endX; ++x) {
+            const int* indices = &plan.columns.indices[static_cast<size_t>(x) * taps];
+            const int16_t* weights = &plan.columns.fixedWeights[static_cast<size_t>(x) * taps];
+            int32_t* total = &totals[(x - startX) * 3];
+            total[0] = total[1] = total[2] = 0;
+            for (int k = 0; k < taps; ++k) {
+                const RGB& pixel = source[indices[k]];
+                total[0] += pixel.blue * weights[k];
+                total[1] += pixel.green * weights[k];
+                total[2] += pixel.red * weights[k];
+            }
+        }
+        kernels.roundInt16(horizontal.data() + (static_cast<size_t>(y) * plan.width + startX) * 3, totals.data(), FixedPointBits - SeparableResizeIntermediateBits, tileValues);
+    }
+}
+
+// Fixed point vertical resize pass over a tile of the fixed point horizontal pass result
+void resizeVerticalPassFixed(const std::vector<int16_t>& horizontal, const ResizePlan& plan, Image& resized, int startX, int startY, int endX, int endY) {
+    int taps = plan.rows.taps, tileValues = (endX - startX) * 3;
+    const RowKernels& kernels = rowKernels();
+    std::vector<int32_t> totals(tileValues);
 
-    // Create and dispatch threads
-    for (unsigned int i = 0; i < numThreads; ++i) {
-        int startX = i * chunkSize; // Calculate the start X for this thread
-        int endX = (i == numThreads - 1) ? newWidth : startX + chunkSize; // Calculate the end X, ensuring the last thread covers the remainder
-        futures.emplace_back(std::async(std::launch::async, worker, startX, endX)); // Launch the thread asynch
+    for (int y = startY; y < endY; ++y) {
+        std::fill(totals.begin(), totals.end(), 0);
+        const int* indices = &plan.rows.indices[static_cast<size_t>(y) * taps];
+        const int16_t* weights = &plan.rows.fixedWeights[static_cast<size_t>(y) * taps];
+        for (int k = 0; k < taps; ++k) {
+            if (weights[k] == 0) continue; // Padding taps
+            kernels.multiplyAddInt16(totals.data(), horizontal.data() + (static_cast<size_t>(indices[k]) * plan.width + startX) * 3, weights[k], tileValues);
+        }
+        kernels.narrowFixed(reinterpret_cast<uint8_t*>(resized.row(y) + startX), totals.data(), FixedPointBits + SeparableResizeIntermediateBits, tileValues);
     }
+}
 
-    // Wait for all threads to complete
-    for (auto &f : futures) {
-        f.get(); // Blocking call to ensure each thread completes
+// Resize an image along a resize plan with multiple threads (both passes split into tiles)
+Image resizeSeparableMultipleThreads(const Image& image, const ResizePlan& plan) {
+    Image resized(plan.width, plan.height);
+    size_t horizontalSize = static_cast<size_t>(plan.width) * plan.sourceHeight * 3; // Every source row resampled to the output width
+
+    // Run one pass on the pool and wait before the next (the vertical pass reads rows from neighbouring tiles of the horizontal pass)
+    ThreadPool& pool = ThreadPool::instance();
+    if (fixedPoint) {
+        std::vector<int16_t> horizontal(horizontalSize);
+        pool.parallelForTiles(plan.width, plan.sourceHeight, tileSize, tileSize, [&](int startX, int startY, int endX, int endY) {
+            resizeHorizontalPassFixed(image, plan, horizontal, startX, startY, endX, endY);
+        });
+        pool.parallelForTiles(plan.width, plan.height, tileSize, tileSize, [&](int startX, int startY, int endX, int endY) {
+            resizeVerticalPassFixed(horizontal, plan, resized, startX, startY, endX, endY);
+        });
+        return resized;
     }
 
-    // Return the resized image
-    return resizedImage;
+    std::vector<float> horizontal(horizontalSize);
+    pool.parallelForTiles(plan.width, plan.sourceHeight, tileSize, tileSize, [&](int startX, int startY, int endX, int endY) {
+        resizeHorizontalPass(image, plan, horizontal, startX, startY, endX, endY);
+    });
+    pool.parallelForTiles(plan.width, plan.height, tileSize, tileSize, [&](int startX, int startY, int endX, int endY) {
+        resizeVerticalPass(horizontal, plan, resized, startX, startY, endX, endY);
+    });
+
+    return resized;
+}
+
+// Save the image as a BMP with multiple threads (the file is sized up front and every thread encodes and writes its own band of rows)
+void writeBmpMultipleThreads(const std::string& filename, const Image& image, bool resize, int resizedWidth, int resizedHeight) {
+    TraceSpan span("write (multiple threads)");
+#ifdef _WIN32
+    writeBmp(filename, image, resize, resizedWidth, resizedHeight); // No pwrite here
+#else
+    int width = resize ? resizedWidth : image.width();
+    int height = resize ? resizedHeight : image.height();
+    int rowPadding = (4 - (width * 3) % 4) % 4;
+    size_t rowSize = static_cast<size_t>(width) * sizeof(RGB) + rowPadding;
+    size_t pixelBytes = static_cast<size_t>(std::min(width, image.width())) * sizeof(RGB); // Bytes of a row taken from the image
+    unsigned char header[54];
+    fillBmpHeader(header, width, height);
+
+    int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::cerr << "Could not open output file for writing." << std::endl;
+        return;
+    }
+    // Size the file first so the bands can land anywhere in it, 64 bit offsets all the way
+    if (ftruncate(fd, static_cast<off_t>(54 + rowSize * height)) != 0 || pwrite(fd, header, 54, 0) != 54) {
+        std::cerr << "Could not write output file." << std::endl;
+        close(fd);
+        return;
+    }
+
+    // Bands of whole rows of about a megabyte each, encoded with their padding into one buffer and written with a single pwrite
+    int bandRows = static_cast<int>(std::clamp<size_t>((1 << 20) / std::max<size_t>(rowSize, 1), 1, static_cast<size_t>(std::max(height, 1))));
+    int bands = (height + bandRows - 1) / bandRows;
+    std::atomic<bool> failed{false};
+    ThreadPool::instance().parallelFor(bands, [&](int firstBand, int endBand) {
+        std::vector<char> buffer(rowSize * bandRows);
+        for (int band = firstBand; band < endBand; ++band) {
+            int startRow = band * bandRows, endRow = std::min(startRow + bandRows, height);
+            std::fill(buffer.begin(), buffer.end(), 0); // Padding and rows beyond the image
+            for (int y = startRow; y < endRow; ++y) {
+                if (y < image.height()) std::memcpy(buffer.data() + (y - startRow) * rowSize, image.row(y), pixelBytes);
+            }
+
+            size_t length = rowSize * (endRow - startRow), done = 0;
+            off_t offset = static_cast<off_t>(54 + rowSize * startRow);
+            while (done < length) {
+                ssize_t written = pwrite(fd, buffer.data() + done, length - done, offset + static_cast<off_t>(done));
+                if (written <= 0) {
+                    failed = true;
+                    break;
+                }
+                done += static_cast<size_t>(written);
+            }
+        }
+    });
+    if (failed) {
+        std::cerr << "Could not write output file." << std::endl;
+    }
+    close(fd);
+#endif
 }
\ No newline at end of file